@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+    Auto gain: the level change of the EQ curve, worked out from its
+    magnitude response instead of metered from the audio.
+  ==============================================================================
+*/
+#include "AutoGain.h"
+
+namespace AutoGain
+{
+    namespace
+    {
+        std::array<Point, NumPoints> makeWeightedPoints()
+        {
+            //BS.1770's two stages as published for 48 kHz: a +4 dB high shelf and the RLB high pass
+            constexpr double referenceRate = 48000.0;
+            auto shelf = juce::dsp::IIR::Coefficients<double>::makeHighShelf(referenceRate, 1681.97, 0.7072, juce::Decibels::decibelsToGain(4.0));
+            auto highPass = juce::dsp::IIR::Coefficients<double>::makeHighPass(referenceRate, 38.135, 0.5003);
+
+            std::array<Point, NumPoints> points;
+            double sum = 0.0;
+            for (int i = 0; i < NumPoints; ++i)
+            {
+                //Equal steps of log frequency, so pink noise puts the same energy at every point
+                const auto frequency = juce::mapToLog10(((double)i + 0.5) / NumPoints, 20.0, 20000.0);
+                const auto magnitude = shelf->getMagnitudeForFrequency(frequency, referenceRate)
+                                     * highPass->getMagnitudeForFrequency(frequency, referenceRate);
+                points[(size_t)i] = { frequency, magnitude * magnitude };
+                sum += magnitude * magnitude;
+            }
+
+            for (auto& point : points)
+                point.weight /= sum;
+            return points;
+        }
+    }
+
+    const std::array<Point, NumPoints>& getWeightedPoints()
+    {
+        static const auto points = makeWeightedPoints();
+        return points;
+    }
+
+    void Response::prepare(double sampleRate)
+    {
+        numPoints = 0;
+        for (const auto& point : getWeightedPoints())
+        {
+            if (point.frequency > 0.45 * sampleRate)
+                break;
+
+            const auto w = juce::MathConstants<double>::twoPi * point.frequency / sampleRate;
+            cosW[(size_t)numPoints] = std::cos(w);
+            cos2W[(size_t)numPoints] = std::cos(2.0 * w);
+            ++numPoints;
+        }
+        clear();
+    }
+
+    void Response::clear()
+    {
+        power.fill(1.0);
+    }
+
+    void Response::addSection(const float* c)
+    {
+        const double b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+        const auto n0 = b0 * b0 + b1 * b1 + b2 * b2, n1 = 2.0 * (b0 * b1 + b1 * b2), n2 = 2.0 * b0 * b2;
+        const auto d0 = 1.0 + a1 * a1 + a2 * a2, d1 = 2.0 * (a1 + a1 * a2), d2 = 2.0 * a2;
+
+        for (int i = 0; i < numPoints; ++i)
+        {
+            const auto denominator = d0 + d1 * cosW[(size_t)i] + d2 * cos2W[(size_t)i];
+            power[(size_t)i] *= (n0 + n1 * cosW[(size_t)i] + n2 * cos2W[(size_t)i]) / juce::jmax(denominator, 1.0e-30);
+        }
+    }
+
+    float Response::getCompensationDecibels() const
+    {
+        const auto& points = getWeightedPoints();
+        double weightedPower = 0.0, totalWeight = 0.0;
+        for (int i = 0; i < numPoints; ++i)
+        {
+            weightedPower += points[(size_t)i].weight * power[(size_t)i];
+            totalWeight += points[(size_t)i].weight;
+        }
+
+        if (totalWeight <= 0.0 || weightedPower <= 0.0)
+            return 0.f;
+
+        const auto decibels = -10.0 * std::log10(weightedPower / totalWeight);
+        return juce::jlimit(-MaxCompensationDecibels, MaxCompensationDecibels, (float)decibels);
+    }
+}
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+    Auto gain: the level change of the EQ curve, worked out from its
+    magnitude response instead of metered from the audio.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+/*
+The compensation is the inverse of how much louder the EQ makes a programme with an even spread of energy
+per octave (pink noise, roughly what music averages out to), as heard through the K weighting of
+ITU-R BS.1770 (the high pass and high shelf in front of LUFS meters):
+
+    compensation = -10 log10( sum w(f) |H(f)|^2 / sum w(f) )
+
+over log spaced frequencies from 20 Hz to 20 kHz, w being the K weighting's power. The processor works it
+out on the audio thread, from the very coefficients it is about to run, in the block where they change, and
+then ramps a gain towards the result.
+*/
+namespace AutoGain
+{
+    constexpr float MaxCompensationDecibels = 24.f; //Either way, like the Peak Gain range
+    constexpr int NumPoints = 120;                  //12 per octave
+
+    struct Point
+    {
+        double frequency, weight; //weight already divided by the sum of all of them
+    };
+
+    //The log spaced frequencies and their normalised K weighting. Worked out once, safe from any thread
+    const std::array<Point, NumPoints>& getWeightedPoints();
+
+    /*
+    The power response of the whole EQ at the points, built up one second order section at a time. With
+    cos(w) and cos(2w) of every point worked out in prepare(), a section is a handful of multiplies per point:
+
+        |H|^2 = (b0^2 + b1^2 + b2^2 + 2 (b0 b1 + b1 b2) cos w + 2 b0 b2 cos 2w)
+              / (1 + a1^2 + a2^2 + 2 (a1 + a1 a2) cos w + 2 a2 cos 2w)
+
+    Only prepare() can't run on the audio thread. Points above 0.45 * sampleRate are left out.
+    */
+    class Response
+    {
+    public:
+        void prepare(double sampleRate);
+        void clear();                     //Back to flat
+        void addSection(const float* c);  //b0 b1 b2 a1 a2, already divided by a0
+        float getCompensationDecibels() const;
+
+    private:
+        int numPoints = 0;
+        std::array<double, NumPoints> cosW{}, cos2W{}, power{};
+    };
+}
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+    Band engine: up to BandEngine::MaxBands extra second order bands that run
+    after the fixed LowCut / Peak / HighCut MonoChain.
+  ==============================================================================
+*/
+#include "BandEngine.h"
+#include "FilterAnalysis.h"
+#include "CoefficientDesign.h"
+
+void BandEngine::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    //Every design depends on the sample rate
+    for (int i = 0; i < MaxBands; ++i)
+        if (!isTransparent(bands[(size_t)i]))
+            designBand(designs[(size_t)i].data(), bands[(size_t)i], sampleRate);
+
+    updateActiveBands();
+    reset();
+}
+
+void BandEngine::setBand(int index, const BandSettings& settings)
+{
+    jassert(juce::isPositiveAndBelow(index, MaxBands));
+    auto& band = bands[(size_t)index];
+
+    if (band == settings)
+        return;
+
+    band = settings;
+    const auto bit = (std::uint32_t)1 << index;
+
+    if (isTransparent(band))
+    {
+        designedMask &= ~bit;
+    }
+    else
+    {
+        //A band that was just switched on starts from silence instead of whatever it held last time it ran
+        if ((designedMask & bit) == 0)
+            for (auto& channelState : state)
+                channelState[(size_t)index] = { 0.f, 0.f };
+
+        designBand(designs[(size_t)index].data(), band, sampleRate);
+        designedMask |= bit;
+    }
+
+    updateActiveBands();
+}
+
+void BandEngine::updateActiveBands()
+{
+    numActive = 0;
+    tailSamples = 0.0;
+
+    for (int i = 0; i < MaxBands; ++i)
+    {
+        if ((designedMask & ((std::uint32_t)1 << i)) == 0)
+            continue;
+
+        tailSamples += getDecayLengthInSamples(designs[(size_t)i].data(), NumCoefficients); //In series, so the decays add up
+        slot[(size_t)numActive++] = i;
+    }
+}
+
+double BandEngine::getMagnitudeForFrequency(double freq) const
+{
+    double mag = 1.0;
+    for (int b = 0; b < numActive; ++b)
+        mag *= ::getMagnitudeForFrequency(designs[(size_t)slot[(size_t)b]].data(), freq, sampleRate);
+    return mag;
+}
+
+void BandEngine::reset()
+{
+    for (auto& channelState : state)
+        for (auto& z : channelState)
+            z = { 0.f, 0.f };
+}
+
+void BandEngine::process(juce::dsp::AudioBlock<float>& block)
+{
+    const auto numChannels = juce::jmin((int)block.getNumChannels(), MaxChannels);
+    const auto numSamples = (int)block.getNumSamples();
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* data = block.getChannelPointer((size_t)ch);
+
+        for (int b = 0; b < numActive; ++b)
+        {
+            const auto index = (size_t)slot[(size_t)b];
+            const auto& c = designs[index];
+            const auto b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+
+            auto& z = state[(size_t)ch][index];
+            auto z1 = z[0], z2 = z[1];
+
+            for (int i = 0; i < numSamples; ++i) //Transposed direct form II, same as juce::dsp::IIR::Filter
+            {
+                const auto x = data[i];
+                const auto y = b0 * x + z1;
+                z1 = b1 * x - a1 * y + z2;
+                z2 = b2 * x - a2 * y;
+                data[i] = y;
+            }
+
+            z[0] = z1;
+            z[1] = z2;
+        }
+    }
+}
+
+bool BandEngine::isTransparent(const BandSettings& settings)
+{
+    if (!settings.enabled)
+        return true;
+
+    switch (settings.type) //Peak and shelves are flat at 0 dB, a notch or a cut never is
+    {
+    case BandType_Peak:
+    case BandType_LowShelf:
+    case BandType_HighShelf: return isUnityGain(settings.gainInDecibels);
+    default:                 return false;
+    }
+}
+
+void BandEngine::designBand(float* c, const BandSettings& settings, double sampleRate)
+{
+    auto freq = juce::jlimit(10.f, (float)(sampleRate * 0.49), settings.freq);
+
+    switch (settings.type)
+    {
+    case BandType_LowShelf:  CoefficientDesign::makeLowShelf(c, sampleRate, freq, settings.quality, settings.gainInDecibels); break;
+    case BandType_HighShelf: CoefficientDesign::makeHighShelf(c, sampleRate, freq, settings.quality, settings.gainInDecibels); break;
+    case BandType_Notch:     CoefficientDesign::makeNotch(c, sampleRate, freq, settings.quality); break;
+    case BandType_LowCut:    CoefficientDesign::makeHighPass(c, sampleRate, freq, settings.quality); break;
+    case BandType_HighCut:   CoefficientDesign::makeLowPass(c, sampleRate, freq, settings.quality); break;
+    case BandType_Peak:
+    default:                 CoefficientDesign::makePeak(c, sampleRate, freq, settings.quality, settings.gainInDecibels); break;
+    }
+}
+
+//==============================================================================
+juce::String getBandParameterID(int index, const juce::String& name)
+{
+    return "Band" + juce::String(index + 1) + " " + name;
+}
+
+BandParameters::BandParameters(juce::AudioProcessorValueTreeState& apvts)
+{
+    for (int i = 0; i < BandEngine::MaxBands; ++i)
+    {
+        auto& band = values[(size_t)i];
+        band.enabled = apvts.getRawParameterValue(getBandParameterID(i, "Enabled"));
+        band.type = apvts.getRawParameterValue(getBandParameterID(i, "Type"));
+        band.freq = apvts.getRawParameterValue(getBandParameterID(i, "Freq"));
+        band.gain = apvts.getRawParameterValue(getBandParameterID(i, "Gain"));
+        band.quality = apvts.getRawParameterValue(getBandParameterID(i, "Quality"));
+        jassert(band.enabled != nullptr && band.type != nullptr && band.freq != nullptr && band.gain != nullptr && band.quality != nullptr);
+    }
+}
+
+BandSettings BandParameters::get(int index) const
+{
+    const auto& band = values[(size_t)index];
+    BandSettings settings;
+    settings.enabled = band.enabled->load(std::memory_order_relaxed) > 0.5f;
+    settings.type = (BandType)(int)band.type->load(std::memory_order_relaxed);
+    settings.freq = band.freq->load(std::memory_order_relaxed);
+    settings.gainInDecibels = band.gain->load(std::memory_order_relaxed);
+    settings.quality = band.quality->load(std::memory_order_relaxed);
+    return settings;
+}
+
+void addBandParameters(juce::AudioProcessorValueTreeState::ParameterLayout& layout)
+{
+    juce::StringArray types{ "Peak", "Low Shelf", "High Shelf", "Notch", "Low Cut", "High Cut" };
+
+    for (int i = 0; i < BandEngine::MaxBands; ++i)
+    {
+        //Spread the default frequencies evenly on a log scale so enabling a band doesn't stack it on top of another one
+        auto defaultFreq = std::round(juce::mapToLog10((i + 0.5f) / (float)BandEngine::MaxBands, 20.f, 20000.f));
+
+        layout.add(std::make_unique<juce::AudioParameterBool>(getBandParameterID(i, "Enabled"), getBandParameterID(i, "Enabled"), false));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(getBandParameterID(i, "Type"), getBandParameterID(i, "Type"), types, 0));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getBandParameterID(i, "Freq"), getBandParameterID(i, "Freq"),
+            juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), defaultFreq));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getBandParameterID(i, "Gain"), getBandParameterID(i, "Gain"),
+            juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f), 0.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getBandParameterID(i, "Quality"), getBandParameterID(i, "Quality"),
+            juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f), 1.f));
+    }
+}
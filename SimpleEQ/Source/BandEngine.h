@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+    Band engine: up to BandEngine::MaxBands extra second order bands that run
+    after the fixed LowCut / Peak / HighCut MonoChain.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+enum BandType
+{
+    BandType_Peak,
+    BandType_LowShelf,
+    BandType_HighShelf,
+    BandType_Notch,
+    BandType_LowCut,
+    BandType_HighCut
+};
+
+struct BandSettings //Extract one band from the AudioProcessorValueTreeState
+{
+    bool enabled{ false };
+    BandType type{ BandType_Peak };
+    float freq{ 1000.f }, gainInDecibels{ 0.f }, quality{ 1.f };
+
+    bool operator== (const BandSettings& other) const
+    {
+        return enabled == other.enabled && type == other.type && freq == other.freq
+            && gainInDecibels == other.gainInDecibels && quality == other.quality;
+    }
+    bool operator!= (const BandSettings& other) const { return !(*this == other); }
+};
+
+/*
+Each band is designed straight into a flat table (CoefficientDesign, no allocation) when its settings change,
+and the table only lists the enabled bands: process() just walks that list, so a disabled band costs nothing,
+not even a bypass check, and the CPU cost follows the number of enabled bands, not the number of slots.
+
+A BandEngine has a single writer. The processor's belongs to the audio thread, which reads the band
+parameters every block like the main chain does (prepare() only runs while processing is stopped); the
+response curve keeps its own on the message thread for getMagnitudeForFrequency().
+*/
+class BandEngine
+{
+public:
+    static constexpr int MaxBands = 24;
+    static constexpr int MaxChannels = 2;
+    static constexpr int NumCoefficients = 5; //b0 b1 b2 a1 a2, already divided by a0
+
+    void prepare(double sampleRate);                       //Redesigns every band for the new rate and clears the state
+    void setBand(int index, const BandSettings& settings); //Redesigns the band if it changed. Doesn't allocate
+    const BandSettings& getBand(int index) const { return bands[(size_t)index]; }
+    double getSampleRate() const { return sampleRate; }
+    double getMagnitudeForFrequency(double freq) const;    //Of every enabled band, for the response curve
+    int getNumActiveBands() const { return numActive; }    //Enabled and not flat
+    const float* getActiveCoefficients(int entry) const { return designs[(size_t)slot[(size_t)entry]].data(); } //entry < getNumActiveBands()
+    double getTailLengthInSamples() const { return tailSamples; } //How long the enabled bands ring, from their poles
+
+    void process(juce::dsp::AudioBlock<float>& block);
+    void reset();                                          //Clears the filter state
+
+private:
+    double sampleRate = 44100.0;
+    std::array<BandSettings, MaxBands> bands;
+    std::array<std::array<float, NumCoefficients>, MaxBands> designs{};
+    std::uint32_t designedMask = 0;                        //bit per slot whose band is enabled and not flat
+
+    //The enabled bands in slot order, rebuilt whenever a band changes
+    int numActive = 0;
+    std::array<int, MaxBands> slot{};                      //which band each entry came from, so it keeps its own filter state
+    double tailSamples = 0.0;
+    void updateActiveBands();
+
+    std::array<std::array<std::array<float, 2>, MaxBands>, MaxChannels> state{}; //TDF-II z1 z2 per channel and slot
+
+    static bool isTransparent(const BandSettings& settings); //Disabled, or a peak/shelf at 0 dB: left out of process()
+    static void designBand(float* c, const BandSettings& settings, double sampleRate);
+};
+
+/*
+The band parameters' atomic values, looked up by ID once instead of by string every time they are read,
+like Parameters::Handles. Reading a band is five relaxed loads, safe from any thread.
+*/
+class BandParameters
+{
+public:
+    explicit BandParameters(juce::AudioProcessorValueTreeState& apvts);
+    BandSettings get(int index) const;
+
+private:
+    struct Values { std::atomic<float>* enabled, * type, * freq, * gain, * quality; };
+    std::array<Values, BandEngine::MaxBands> values{};
+};
+
+juce::String getBandParameterID(int index, const juce::String& name); //e.g. getBandParameterID(0, "Freq") -> "Band1 Freq"
+void addBandParameters(juce::AudioProcessorValueTreeState::ParameterLayout& layout);
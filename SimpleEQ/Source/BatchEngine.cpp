@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+    Batch engine: the LowCut / Peak / HighCut chain on many independent mono
+    streams at once, one stream per SIMD lane.
+  ==============================================================================
+*/
+#include "BatchEngine.h"
+#include "CoefficientDesign.h"
+
+namespace
+{
+    constexpr int PeakSection = 4, HighCutSection = 5;
+
+    ChainSettings getFlatSettings()
+    {
+        ChainSettings flat;
+        flat.lowCutFreq = 20.f;
+        flat.highCutFreq = 20000.f;
+        flat.peakFreq = 750.f;
+        return flat;
+    }
+}
+
+void BatchEngine::prepare(double newSampleRate, int maxStreams, int newMaxBlockSize)
+{
+    jassert(maxStreams > 0 && newMaxBlockSize > 0);
+    sampleRate = newSampleRate;
+    maxBlockSize = newMaxBlockSize;
+
+    const auto numGroups = (maxStreams + Lanes - 1) / Lanes;
+    settings.resize((size_t)maxStreams, getFlatSettings()); //Streams that were already set keep their settings
+    streamSections.assign((size_t)maxStreams, 0);
+    groupSections.assign((size_t)numGroups, 0);
+    coefficients.assign((size_t)(numGroups * MaxSections), Section{});
+    state.assign((size_t)(numGroups * MaxSections), State{});
+    interleaved.assign((size_t)maxBlockSize, Vec::expand(0.f));
+
+    for (int stream = 0; stream < maxStreams; ++stream)
+        designStream(stream); //Every design depends on the sample rate
+
+    reset();
+}
+
+void BatchEngine::setStream(int stream, const ChainSettings& newSettings)
+{
+    jassert(juce::isPositiveAndBelow(stream, getMaxStreams()));
+    auto& current = settings[(size_t)stream];
+
+    if (current == newSettings)
+        return;
+
+    current = newSettings;
+    designStream(stream);
+}
+
+void BatchEngine::reset()
+{
+    for (auto& s : state)
+        s.z1 = s.z2 = Vec::expand(0.f);
+}
+
+int BatchEngine::getNumActiveSections(int stream) const
+{
+    int count = 0;
+    for (auto mask = streamSections[(size_t)stream]; mask != 0; mask &= (std::uint16_t)(mask - 1))
+        ++count;
+    return count;
+}
+
+void BatchEngine::setLane(int stream, int section, const float* c)
+{
+    const auto lane = (size_t)(stream % Lanes);
+    auto& k = coefficients[(size_t)((stream / Lanes) * MaxSections + section)];
+
+    k.b0.set(lane, c[0]);
+    k.b1.set(lane, c[1]);
+    k.b2.set(lane, c[2]);
+    k.a1.set(lane, c[3]);
+    k.a2.set(lane, c[4]);
+}
+
+void BatchEngine::designStream(int stream)
+{
+    const auto& s = settings[(size_t)stream];
+    const float passThrough[CoefficientDesign::NumCoefficients] = { 1.f, 0.f, 0.f, 0.f, 0.f };
+    float c[CoefficientDesign::NumCoefficients];
+    std::uint16_t used = 0;
+
+    for (int section = 0; section < MaxSections; ++section)
+        setLane(stream, section, passThrough);
+
+    //Same sections as updateCutFilter() and updatePeakFilter() set up in a MonoChain
+    const auto lowCutOrder = 2 * (s.lowCutSlope + 1);
+    for (int i = 0; i <= s.lowCutSlope; ++i)
+    {
+        CoefficientDesign::makeHighPass(c, sampleRate, s.lowCutFreq, CoefficientDesign::getButterworthQuality(lowCutOrder, i));
+        setLane(stream, i, c);
+        used |= (std::uint16_t)(1 << i);
+    }
+
+    if (!isUnityGain(s.peakGainInDecibels))
+    {
+        CoefficientDesign::makePeak(c, sampleRate, s.peakFreq, s.peakQuality, s.peakGainInDecibels);
+        setLane(stream, PeakSection, c);
+        used |= (std::uint16_t)(1 << PeakSection);
+    }
+
+    const auto highCutOrder = 2 * (s.highCutSlope + 1);
+    for (int i = 0; i <= s.highCutSlope; ++i)
+    {
+        CoefficientDesign::makeLowPass(c, sampleRate, s.highCutFreq, CoefficientDesign::getButterworthQuality(highCutOrder, i));
+        setLane(stream, HighCutSection + i, c);
+        used |= (std::uint16_t)(1 << (HighCutSection + i));
+    }
+
+    //A section coming back into use starts from silence, like setChainPositionActive() does. One that goes out of
+    //use is cleared as well: its lane keeps running as pass through whenever another stream of the group uses the
+    //section, and y = x + z1 would add whatever the lane still held
+    const auto group = stream / Lanes;
+    const auto lane = (size_t)(stream % Lanes);
+    const auto switched = (std::uint16_t)(used ^ streamSections[(size_t)stream]);
+    for (int section = 0; section < MaxSections; ++section)
+    {
+        if ((switched & (1 << section)) != 0)
+        {
+            auto& z = state[(size_t)(group * MaxSections + section)];
+            z.z1.set(lane, 0.f);
+            z.z2.set(lane, 0.f);
+        }
+    }
+
+    streamSections[(size_t)stream] = used;
+
+    std::uint16_t groupMask = 0;
+    for (int i = group * Lanes; i < juce::jmin((group + 1) * Lanes, getMaxStreams()); ++i)
+        groupMask |= streamSections[(size_t)i];
+    groupSections[(size_t)group] = groupMask;
+}
+
+void BatchEngine::process(float* const* channels, int numStreams, int numSamples)
+{
+    jassert(numStreams <= getMaxStreams());
+    juce::ScopedNoDenormals noDenormals;
+
+    const auto numGroups = (numStreams + Lanes - 1) / Lanes;
+
+    for (int start = 0; start < numSamples; start += maxBlockSize)
+    {
+        const auto num = juce::jmin(maxBlockSize, numSamples - start);
+        for (int group = 0; group < numGroups; ++group)
+            processGroup(group, channels, juce::jmin(Lanes, numStreams - group * Lanes), start, num);
+    }
+}
+
+void BatchEngine::processGroup(int group, float* const* channels, int numLanes, int startSample, int numSamples)
+{
+    const auto mask = groupSections[(size_t)group];
+    if (mask == 0) //Every stream in the group is flat
+        return;
+
+    //Frame i of 'interleaved' holds sample i of every stream in the group, one per lane
+    auto* frames = reinterpret_cast<float*>(interleaved.data());
+    for (int lane = 0; lane < Lanes; ++lane)
+    {
+        if (lane < numLanes)
+        {
+            const auto* source = channels[group * Lanes + lane] + startSample;
+            for (int i = 0; i < numSamples; ++i)
+                frames[i * Lanes + lane] = source[i];
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i) //Lanes past the last stream filter silence
+                frames[i * Lanes + lane] = 0.f;
+        }
+    }
+
+    for (int section = 0; section < MaxSections; ++section)
+    {
+        if ((mask & (1 << section)) == 0)
+            continue;
+
+        const auto& k = coefficients[(size_t)(group * MaxSections + section)];
+        const auto b0 = k.b0, b1 = k.b1, b2 = k.b2, a1 = k.a1, a2 = k.a2;
+        auto& z = state[(size_t)(group * MaxSections + section)];
+        auto z1 = z.z1, z2 = z.z2;
+
+        for (int i = 0; i < numSamples; ++i) //Transposed direct form II, same as juce::dsp::IIR::Filter
+        {
+            const auto x = interleaved[(size_t)i];
+            const auto y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            interleaved[(size_t)i] = y;
+        }
+
+        z.z1 = z1;
+        z.z2 = z2;
+    }
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        auto* destination = channels[group * Lanes + lane] + startSample;
+        for (int i = 0; i < numSamples; ++i)
+            destination[i] = frames[i * Lanes + lane];
+    }
+}
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+    Batch engine: the LowCut / Peak / HighCut chain on many independent mono
+    streams at once, one stream per SIMD lane.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include "PluginProcessor.h"
+
+/*
+Same topology and designs as MonoChain, for back ends that run it on lots of mono streams with
+different settings. Streams are grouped Lanes at a time (the width of juce::dsp::SIMDRegister<float>),
+and every section's coefficients and state are stored structure of arrays: one register holds b0 of the
+same section in Lanes streams, so one multiply filters Lanes streams.
+
+A section that is pass through in every stream of a group (a 12 dB cut doesn't use stages 2-4, a flat
+peak, an inactive cut) is skipped for that group. The Peak is always static here: 'peakDynamic' and the
+sidechain settings are ignored.
+
+Not thread safe: setStream() and process() have to come from the same thread, or never overlap.
+Nothing allocates after prepare().
+*/
+class BatchEngine
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int Lanes = (int)Vec::SIMDNumElements;
+    static constexpr int MaxSections = 9; //4 LowCut stages, the Peak, 4 HighCut stages
+
+    void prepare(double sampleRate, int maxStreams, int maxBlockSize);
+    void setStream(int stream, const ChainSettings& settings); //Only redesigns when the settings changed
+    const ChainSettings& getStream(int stream) const { return settings[(size_t)stream]; }
+    void reset();                                              //Clears the filter state of every stream
+
+    //channels[i] is stream i, processed in place. numStreams <= maxStreams, any numSamples
+    void process(float* const* channels, int numStreams, int numSamples);
+
+    int getMaxStreams() const { return (int)settings.size(); }
+    int getNumActiveSections(int stream) const; //Biquads the stream really needs, what the scalar path would run
+
+private:
+    struct Section
+    {
+        Vec b0, b1, b2, a1, a2;
+    };
+    struct State
+    {
+        Vec z1, z2;
+    };
+
+    double sampleRate = 44100.0;
+    int maxBlockSize = 0;
+    std::vector<ChainSettings> settings;
+    std::vector<std::uint16_t> streamSections; //Bit per section the stream uses
+    std::vector<std::uint16_t> groupSections;  //OR of its streams: what process() runs for the group
+    std::vector<Section> coefficients;         //[group * MaxSections + section]
+    std::vector<State> state;                  //Same layout
+    std::vector<Vec> interleaved;              //maxBlockSize frames of Lanes samples
+
+    void designStream(int stream);
+    void setLane(int stream, int section, const float* c); //b0 b1 b2 a1 a2
+    void processGroup(int group, float* const* channels, int numLanes, int startSample, int numSamples);
+};
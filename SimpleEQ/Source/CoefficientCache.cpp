@@ -0,0 +1,222 @@
+/*
+  ==============================================================================
+    Memoised coefficient designs for the cut and peak filters.
+  ==============================================================================
+*/
+#include "CoefficientCache.h"
+
+CoefficientCache::CoefficientCache() : entries(new Entry[Capacity])
+{
+    for (auto& key : pending)
+        key.store(0, std::memory_order_relaxed);
+
+    startTimerHz(30);
+}
+
+CoefficientCache::~CoefficientCache()
+{
+    stopTimer();
+}
+
+std::uint64_t CoefficientCache::makeKey(Type type, float freq, std::uint32_t param, double sampleRate)
+{
+    //  63: always set so a key is never 0 (empty)
+    //  0-1: type, 2-16: freq in Hz, 17-32: order or gain/Q steps, 33-52: sample rate in Hz
+    auto freqHz = (std::uint64_t)juce::jlimit(0, 0x7fff, juce::roundToInt(freq));
+    auto rate = (std::uint64_t)juce::jlimit(0, 0xfffff, juce::roundToInt(sampleRate));
+
+    return ((std::uint64_t)1 << 63)
+         | (std::uint64_t)type
+         | (freqHz << 2)
+         | ((std::uint64_t)(param & 0xffff) << 17)
+         | (rate << 33);
+}
+
+std::uint64_t CoefficientCache::makePeakKey(float freq, float quality, float gainInDecibels, double sampleRate)
+{
+    //Gain in 0.5 dB steps from -48 dB, Q in 0.05 steps
+    auto gainSteps = (std::uint32_t)juce::jlimit(0, 0xff, juce::roundToInt((gainInDecibels + 48.f) * 2.f));
+    auto qSteps = (std::uint32_t)juce::jlimit(0, 0xff, juce::roundToInt(quality * 20.f));
+    return makeKey(Type_Peak, freq, gainSteps | (qSteps << 8), sampleRate);
+}
+
+std::uint64_t CoefficientCache::hashKey(std::uint64_t key)
+{
+    //splitmix64 finaliser, the low bits of the key alone would cluster
+    auto h = key;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+template<typename DesignFunction>
+const CutCoefficients& CoefficientCache::getOrDesign(std::uint64_t key, CutCoefficients& scratch, DesignFunction&& design)
+{
+    const auto h = hashKey(key);
+
+    for (int probe = 0; probe < MaxProbes; ++probe)
+    {
+        auto& entry = entries[(size_t)((h + (std::uint64_t)probe) & (Capacity - 1))];
+        auto existing = entry.key.load(std::memory_order_acquire);
+
+        if (existing == 0)
+        {
+            if (entry.key.compare_exchange_strong(existing, key, std::memory_order_acq_rel))
+            {
+                //This thread owns the slot now: design into it, then publish
+                entry.coefficients = design();
+                entry.ready.store(true, std::memory_order_release);
+                numEntries.fetch_add(1, std::memory_order_relaxed);
+                misses.fetch_add(1, std::memory_order_relaxed);
+                return entry.coefficients;
+            }
+            //Somebody else claimed it first, 'existing' now holds their key
+        }
+
+        if (existing == key)
+        {
+            if (entry.ready.load(std::memory_order_acquire))
+            {
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return entry.coefficients;
+            }
+            break; //Still being designed by the other thread, don't wait for it
+        }
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+    scratch = design();
+    return scratch;
+}
+
+const CutCoefficients& CoefficientCache::getLowCut(float freq, int order, double sampleRate, CutCoefficients& scratch)
+{
+    return getOrDesign(makeKey(Type_LowCut, freq, (std::uint32_t)order, sampleRate), scratch, [=]
+    {
+        return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(freq, sampleRate, order);
+    });
+}
+
+const CutCoefficients& CoefficientCache::getHighCut(float freq, int order, double sampleRate, CutCoefficients& scratch)
+{
+    return getOrDesign(makeKey(Type_HighCut, freq, (std::uint32_t)order, sampleRate), scratch, [=]
+    {
+        return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(freq, sampleRate, order);
+    });
+}
+
+juce::dsp::IIR::Coefficients<float>::Ptr CoefficientCache::getPeak(float freq, float quality, float gainInDecibels, double sampleRate)
+{
+    CutCoefficients scratch;
+    auto& designed = getOrDesign(makePeakKey(freq, quality, gainInDecibels, sampleRate), scratch, [=]
+    {
+        CutCoefficients single;
+        single.add(juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, freq, quality,
+                                                                        juce::Decibels::decibelsToGain(gainInDecibels)));
+        return single;
+    });
+
+    return designed[0];
+}
+
+const CutCoefficients* CoefficientCache::find(std::uint64_t key) const
+{
+    const auto h = hashKey(key);
+
+    for (int probe = 0; probe < MaxProbes; ++probe)
+    {
+        auto& entry = entries[(size_t)((h + (std::uint64_t)probe) & (Capacity - 1))];
+        auto existing = entry.key.load(std::memory_order_acquire);
+
+        if (existing == 0)
+            break; //Slots are never emptied, so the key isn't further along either
+
+        if (existing == key && entry.ready.load(std::memory_order_acquire))
+        {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return &entry.coefficients;
+        }
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+    queueDesign(key);
+    return nullptr;
+}
+
+void CoefficientCache::queueDesign(std::uint64_t key) const
+{
+    if (numEntries.load(std::memory_order_relaxed) >= Capacity)
+        return; //Nowhere to put it
+
+    const auto h = hashKey(key);
+    for (int probe = 0; probe < 4; ++probe)
+    {
+        auto& slot = pending[(size_t)((h + (std::uint64_t)probe) & (MaxPending - 1))];
+        auto existing = slot.load(std::memory_order_relaxed);
+
+        if (existing == key)
+            return; //Already asked for
+
+        if (existing == 0 && slot.compare_exchange_strong(existing, key, std::memory_order_release))
+        {
+            anyPending.store(true, std::memory_order_release);
+            return;
+        }
+    }
+    //All taken: dropped, the next block misses and asks again
+}
+
+void CoefficientCache::timerCallback()
+{
+    if (!anyPending.exchange(false, std::memory_order_acquire))
+        return;
+
+    for (auto& slot : pending)
+        if (auto key = slot.exchange(0, std::memory_order_acq_rel))
+            design(key);
+}
+
+void CoefficientCache::design(std::uint64_t key)
+{
+    //The inverse of makeKey()/makePeakKey(). The parameters move in the same steps the key stores, so nothing is lost
+    const auto type = (Type)(key & 3);
+    const auto freq = (float)((key >> 2) & 0x7fff);
+    const auto param = (std::uint32_t)((key >> 17) & 0xffff);
+    const auto sampleRate = (double)((key >> 33) & 0xfffff);
+    CutCoefficients scratch;
+
+    switch (type)
+    {
+    case Type_LowCut: getLowCut(freq, (int)param, sampleRate, scratch); break;
+    case Type_HighCut: getHighCut(freq, (int)param, sampleRate, scratch); break;
+    case Type_Peak: getPeak(freq, (float)(param >> 8) / 20.f, (float)(param & 0xff) / 2.f - 48.f, sampleRate); break;
+    }
+}
+
+const CutCoefficients* CoefficientCache::findLowCut(float freq, int order, double sampleRate) const
+{
+    return find(makeKey(Type_LowCut, freq, (std::uint32_t)order, sampleRate));
+}
+
+const CutCoefficients* CoefficientCache::findHighCut(float freq, int order, double sampleRate) const
+{
+    return find(makeKey(Type_HighCut, freq, (std::uint32_t)order, sampleRate));
+}
+
+const CutCoefficients* CoefficientCache::findPeak(float freq, float quality, float gainInDecibels, double sampleRate) const
+{
+    return find(makePeakKey(freq, quality, gainInDecibels, sampleRate));
+}
+
+size_t CoefficientCache::getMemoryUsage() const
+{
+    //Every design is a Coefficients object per section plus its array of 5 (first order 3) floats
+    constexpr size_t bytesPerSection = sizeof(juce::dsp::IIR::Coefficients<float>) + 8 * sizeof(float);
+
+    size_t numSections = 0;
+    for (int i = 0; i < Capacity; ++i)
+        if (entries[(size_t)i].ready.load(std::memory_order_acquire))
+            numSections += (size_t)entries[(size_t)i].coefficients.size();
+
+    return (size_t)Capacity * sizeof(Entry) + sizeof(pending) + numSections * bytesPerSection;
+}
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+    Memoised coefficient designs for the cut and peak filters.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+
+using CutCoefficients = juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>>;
+
+/*
+The parameters move in fixed steps (1 Hz, 0.5 dB, 0.05 Q), so automation keeps asking for the same designs.
+Each design is stored once in a fixed size open addressing table keyed by (type, freq, order/gain/Q, sample rate).
+
+Reading is lock free: a slot is claimed with a compare and swap on its key, filled, then marked ready,
+and it is never changed or removed afterwards, so a reader that sees 'ready' can use it without a lock.
+When the table (or the probe sequence) is full the design is done into the caller's scratch array instead,
+exactly like before the cache existed.
+Old sample rates stay in the table, so prepareToPlay never has to clear it while the editor may be reading.
+
+One table per process, through a juce::SharedResourcePointer: every instance asks for the same designs.
+The audio thread only calls find*(). A miss queues its key, and a message thread timer designs the queued keys
+into the table, so automation with the editor closed hits from the next few blocks on.
+*/
+class CoefficientCache : private juce::Timer
+{
+public:
+    CoefficientCache();
+    ~CoefficientCache() override;
+
+    //Both return either the cached design or 'scratch' after designing into it
+    const CutCoefficients& getLowCut(float freq, int order, double sampleRate, CutCoefficients& scratch);
+    const CutCoefficients& getHighCut(float freq, int order, double sampleRate, CutCoefficients& scratch);
+    juce::dsp::IIR::Coefficients<float>::Ptr getPeak(float freq, float quality, float gainInDecibels, double sampleRate);
+
+    //Lookup only, for the audio thread: nullptr when the design isn't in the table (yet), and the key is queued
+    //for the timer. Never designs or claims a slot
+    const CutCoefficients* findLowCut(float freq, int order, double sampleRate) const;
+    const CutCoefficients* findHighCut(float freq, int order, double sampleRate) const;
+    const CutCoefficients* findPeak(float freq, float quality, float gainInDecibels, double sampleRate) const; //One element array
+
+    std::uint64_t getNumHits() const { return hits.load(std::memory_order_relaxed); }
+    std::uint64_t getNumMisses() const { return misses.load(std::memory_order_relaxed); }
+    int getNumEntries() const { return numEntries.load(std::memory_order_relaxed); }
+    size_t getMemoryUsage() const; //The table and the designs in it, for MemoryReport
+
+    static constexpr int Capacity = 4096; //power of two
+    static constexpr int MaxProbes = 16;
+    static constexpr int MaxPending = 64; //power of two. Misses waiting for the timer, more are dropped and asked for again
+
+private:
+    enum Type
+    {
+        Type_LowCut = 1,
+        Type_HighCut,
+        Type_Peak
+    };
+
+    struct Entry
+    {
+        std::atomic<std::uint64_t> key{ 0 }; //0 means empty
+        std::atomic<bool> ready{ false };
+        CutCoefficients coefficients;         //A peak design is stored as a one element array
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    mutable std::atomic<std::uint64_t> hits{ 0 }, misses{ 0 }; //find() counts too
+    std::atomic<int> numEntries{ 0 };
+
+    mutable std::atomic<std::uint64_t> pending[MaxPending]; //Keys, 0 means free
+    mutable std::atomic<bool> anyPending{ false };
+    void queueDesign(std::uint64_t key) const;
+    void timerCallback() override;
+    void design(std::uint64_t key); //Message thread, rebuilds the arguments from the key
+
+    template<typename DesignFunction>
+    const CutCoefficients& getOrDesign(std::uint64_t key, CutCoefficients& scratch, DesignFunction&& design);
+    const CutCoefficients* find(std::uint64_t key) const;
+
+    static std::uint64_t makeKey(Type type, float freq, std::uint32_t param, double sampleRate);
+    static std::uint64_t makePeakKey(float freq, float quality, float gainInDecibels, double sampleRate);
+    static std::uint64_t hashKey(std::uint64_t key);
+};
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+    The JUCE designs the plugin uses, computed straight into existing storage.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <cmath>
+
+/*
+IIR::Coefficients::makeXXX and FilterDesign return new objects, so they allocate. These write the same
+five numbers (b0 b1 b2 a1 a2, divided by a0: the layout of a second order IIR::Coefficients) into 'c',
+which is what the audio thread needs when the coefficient cache doesn't have a design yet.
+*/
+namespace CoefficientDesign
+{
+    constexpr int NumCoefficients = 5;
+
+    inline void normalise(float* c, double b0, double b1, double b2, double a0, double a1, double a2)
+    {
+        const auto a0inv = 1.0 / a0;
+        c[0] = (float)(b0 * a0inv);
+        c[1] = (float)(b1 * a0inv);
+        c[2] = (float)(b2 * a0inv);
+        c[3] = (float)(a1 * a0inv);
+        c[4] = (float)(a2 * a0inv);
+    }
+
+    //Same as IIR::Coefficients::makePeakFilter
+    inline void makePeak(float* c, double sampleRate, float freq, float quality, float gainInDecibels)
+    {
+        const auto A = std::sqrt((double)juce::Decibels::decibelsToGain(gainInDecibels));
+        const auto omega = juce::MathConstants<double>::twoPi * juce::jmax((double)freq, 2.0) / sampleRate;
+        const auto alpha = std::sin(omega) / (quality * 2.0);
+        const auto c2 = -2.0 * std::cos(omega);
+
+        normalise(c, 1.0 + alpha * A, c2, 1.0 - alpha * A, 1.0 + alpha / A, c2, 1.0 - alpha / A);
+    }
+
+    //Same as IIR::Coefficients::makeHighPass
+    inline void makeHighPass(float* c, double sampleRate, float freq, double quality)
+    {
+        const auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * freq / sampleRate);
+        const auto nSquared = n * n;
+        const auto invQ = 1.0 / quality;
+
+        normalise(c, nSquared, -2.0 * nSquared, nSquared, 1.0 + invQ * n + nSquared, 2.0 * (1.0 - nSquared), 1.0 - invQ * n + nSquared);
+    }
+
+    //Same as IIR::Coefficients::makeLowPass
+    inline void makeLowPass(float* c, double sampleRate, float freq, double quality)
+    {
+        const auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * freq / sampleRate);
+        const auto nSquared = n * n;
+        const auto invQ = 1.0 / quality;
+
+        normalise(c, 1.0, 2.0, 1.0, 1.0 + invQ * n + nSquared, 2.0 * (1.0 - nSquared), 1.0 - invQ * n + nSquared);
+    }
+
+    //Same as IIR::Coefficients::makeLowShelf
+    inline void makeLowShelf(float* c, double sampleRate, float freq, float quality, float gainInDecibels)
+    {
+        const auto A = std::sqrt((double)juce::Decibels::decibelsToGain(gainInDecibels));
+        const auto aminus1 = A - 1.0, aplus1 = A + 1.0;
+        const auto omega = juce::MathConstants<double>::twoPi * juce::jmax((double)freq, 2.0) / sampleRate;
+        const auto coso = std::cos(omega);
+        const auto beta = std::sin(omega) * std::sqrt(A) / quality;
+        const auto aminus1TimesCoso = aminus1 * coso;
+
+        normalise(c, A * (aplus1 - aminus1TimesCoso + beta), A * 2.0 * (aminus1 - aplus1 * coso), A * (aplus1 - aminus1TimesCoso - beta),
+                  aplus1 + aminus1TimesCoso + beta, -2.0 * (aminus1 + aplus1 * coso), aplus1 + aminus1TimesCoso - beta);
+    }
+
+    //Same as IIR::Coefficients::makeHighShelf
+    inline void makeHighShelf(float* c, double sampleRate, float freq, float quality, float gainInDecibels)
+    {
+        const auto A = std::sqrt((double)juce::Decibels::decibelsToGain(gainInDecibels));
+        const auto aminus1 = A - 1.0, aplus1 = A + 1.0;
+        const auto omega = juce::MathConstants<double>::twoPi * juce::jmax((double)freq, 2.0) / sampleRate;
+        const auto coso = std::cos(omega);
+        const auto beta = std::sin(omega) * std::sqrt(A) / quality;
+        const auto aminus1TimesCoso = aminus1 * coso;
+
+        normalise(c, A * (aplus1 + aminus1TimesCoso + beta), A * -2.0 * (aminus1 + aplus1 * coso), A * (aplus1 + aminus1TimesCoso - beta),
+                  aplus1 - aminus1TimesCoso + beta, 2.0 * (aminus1 - aplus1 * coso), aplus1 - aminus1TimesCoso - beta);
+    }
+
+    //Same as IIR::Coefficients::makeNotch
+    inline void makeNotch(float* c, double sampleRate, float freq, double quality)
+    {
+        const auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * freq / sampleRate);
+        const auto nSquared = n * n;
+        const auto invQ = 1.0 / quality;
+
+        normalise(c, nSquared + 1.0, 2.0 * (1.0 - nSquared), nSquared + 1.0, 1.0 + n * invQ + nSquared, 2.0 * (1.0 - nSquared), 1.0 - n * invQ + nSquared);
+    }
+
+    //Q of each second order section of an even order Butterworth, in the order FilterDesign::designIIR...ButterworthMethod returns them
+    inline double getButterworthQuality(int order, int section)
+    {
+        return 1.0 / (2.0 * std::cos((2.0 * section + 1.0) * juce::MathConstants<double>::pi / (2.0 * order)));
+    }
+}
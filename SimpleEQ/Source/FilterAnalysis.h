@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+    Helpers that look at designed coefficients without running any audio.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <cmath>
+#include <complex>
+
+//A peak or shelf whose gain is within this of 0 dB doesn't change the signal in any way worth a biquad
+constexpr float unityToleranceInDecibels = 0.05f;
+inline bool isUnityGain(float gainInDecibels) { return std::abs(gainInDecibels) <= unityToleranceInDecibels; }
+
+/*
+Number of samples for the impulse response of one section to decay by 'decayInDecibels',
+from the radius of its slowest pole. Takes the JUCE coefficient layout: b0 b1 a1 (first order)
+or b0 b1 b2 a1 a2 (second order), already divided by a0.
+*/
+inline double getDecayLengthInSamples(const float* c, int numCoefficients, double decayInDecibels = 120.0)
+{
+    double radius = 0.0;
+
+    if (numCoefficients == 3)
+    {
+        radius = std::abs((double)c[2]);
+    }
+    else if (numCoefficients == 5)
+    {
+        //Poles are the roots of z^2 + a1 z + a2
+        const double a1 = c[3], a2 = c[4];
+        const double disc = a1 * a1 - 4.0 * a2;
+
+        if (disc < 0.0)
+            radius = std::sqrt(a2); //complex pair, |p|^2 = a2
+        else
+            radius = juce::jmax(std::abs((-a1 + std::sqrt(disc)) * 0.5), std::abs((-a1 - std::sqrt(disc)) * 0.5));
+    }
+    else
+    {
+        jassertfalse; //Only first and second order sections in this plugin
+        return 0.0;
+    }
+
+    if (radius <= 0.0)
+        return 2.0; //FIR section, only the delay line itself
+
+    if (radius >= 1.0)
+        return 1.0e9; //Not decaying, never call it silent
+
+    //radius^n = 10^(-decay / 20)
+    return (-decayInDecibels / 20.0) * std::log(10.0) / std::log(radius);
+}
+
+inline double getDecayLengthInSamples(const juce::dsp::IIR::Coefficients<float>& coefficients, double decayInDecibels = 120.0)
+{
+    auto& c = coefficients.coefficients;
+    return getDecayLengthInSamples(c.begin(), c.size(), decayInDecibels);
+}
+
+//|H| of one second order section (b0 b1 b2 a1 a2, divided by a0) at 'freq', like IIR::Coefficients::getMagnitudeForFrequency
+inline double getMagnitudeForFrequency(const float* c, double freq, double sampleRate)
+{
+    const auto z = std::polar(1.0, -juce::MathConstants<double>::twoPi * freq / sampleRate); //z^-1
+    const auto numerator = (double)c[0] + z * ((double)c[1] + z * (double)c[2]);
+    const auto denominator = 1.0 + z * ((double)c[3] + z * (double)c[4]);
+    return std::abs(numerator) / std::abs(denominator);
+}
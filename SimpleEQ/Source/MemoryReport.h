@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+    Per instance memory use, for budgeting sessions with many instances.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+/*
+What one plugin instance holds, item by item: the processor, its analyser capture, and the editor's
+analyser while it is open. Heap sizes are counted from the containers' sizes, so they are close but not
+exact (allocator overhead and JUCE internals aren't seen). Shared items are held once per process
+whatever the number of instances, and are listed apart from the instance total.
+*/
+struct MemoryReport
+{
+    struct Item
+    {
+        juce::String name;
+        size_t bytes = 0;
+        bool shared = false;
+    };
+    std::vector<Item> items;
+
+    void add(const juce::String& name, size_t bytes, bool shared = false) { items.push_back({ name, bytes, shared }); }
+
+    size_t getInstanceBytes() const { return getTotal(false); }
+    size_t getSharedBytes() const { return getTotal(true); }
+
+    static juce::String formatBytes(size_t bytes) { return juce::String((double)bytes / 1024.0, 1) + " KB"; }
+
+    juce::String toString() const //One line per item, then the totals
+    {
+        juce::String text;
+        for (auto& item : items)
+            text << item.name << (item.shared ? " (shared)" : "") << ": " << formatBytes(item.bytes) << "\n";
+        return text << "instance " << formatBytes(getInstanceBytes()) << ", shared " << formatBytes(getSharedBytes());
+    }
+
+private:
+    size_t getTotal(bool shared) const
+    {
+        size_t total = 0;
+        for (auto& item : items)
+            if (item.shared == shared)
+                total += item.bytes;
+        return total;
+    }
+};
+
+//Heap bytes held by the containers the analyser uses
+namespace MemoryUsage
+{
+    inline size_t of(const juce::AudioBuffer<float>& buffer)
+    {
+        return (size_t)buffer.getNumChannels() * (size_t)buffer.getNumSamples() * sizeof(float);
+    }
+
+    template<typename Element>
+    size_t of(const std::vector<Element>& vector) { return vector.capacity() * sizeof(Element); }
+
+    inline size_t of(const juce::Image& image)
+    {
+        if (!image.isValid())
+            return 0;
+        const size_t bytesPerPixel = image.getFormat() == juce::Image::SingleChannel ? 1 : (image.getFormat() == juce::Image::RGB ? 3 : 4);
+        return (size_t)image.getWidth() * (size_t)image.getHeight() * bytesPerPixel;
+    }
+
+    //juce::Path doesn't say how much it holds, so this walks it: a float per element type, two per point
+    inline size_t of(const juce::Path& path)
+    {
+        size_t numFloats = 0;
+        for (juce::Path::Iterator it(path); it.next();)
+        {
+            switch (it.elementType)
+            {
+            case juce::Path::Iterator::startNewSubPath:
+            case juce::Path::Iterator::lineTo:      numFloats += 3; break;
+            case juce::Path::Iterator::quadraticTo: numFloats += 5; break;
+            case juce::Path::Iterator::cubicTo:     numFloats += 7; break;
+            case juce::Path::Iterator::closePath:   numFloats += 1; break;
+            }
+        }
+        return numFloats * sizeof(float);
+    }
+}
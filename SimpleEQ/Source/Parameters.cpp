@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+    The main parameters, described once in a compile time table.
+  ==============================================================================
+*/
+#include "Parameters.h"
+
+namespace Parameters
+{
+    void addToLayout(juce::AudioProcessorValueTreeState::ParameterLayout& layout)
+    {
+        for (const auto& spec : table)
+        {
+            switch (spec.kind)
+            {
+            case Kind::Float:
+                layout.add(std::make_unique<juce::AudioParameterFloat>(spec.name, spec.name,
+                    juce::NormalisableRange<float>(spec.minimum, spec.maximum, spec.interval, spec.skew), spec.defaultValue));
+                break;
+            case Kind::Choice:
+            {
+                juce::StringArray choices;
+                for (int i = 0; i < spec.numChoices; ++i)
+                    choices.add(spec.choices[i]);
+                layout.add(std::make_unique<juce::AudioParameterChoice>(spec.name, spec.name, choices, (int)spec.defaultValue));
+                break;
+            }
+            case Kind::Bool:
+                layout.add(std::make_unique<juce::AudioParameterBool>(spec.name, spec.name, spec.defaultValue > 0.5f));
+                break;
+            }
+        }
+    }
+
+    Handles::Handles(juce::AudioProcessorValueTreeState& apvts)
+    {
+        for (const auto& spec : table)
+        {
+            values[(size_t)spec.id] = apvts.getRawParameterValue(spec.name);
+            jassert(values[(size_t)spec.id] != nullptr); //The layout wasn't made with addToLayout()
+        }
+    }
+}
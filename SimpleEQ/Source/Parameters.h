@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+    The main parameters, described once in a compile time table.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/*
+Every main parameter is written down here and nowhere else: its ID (also its name, and what sessions and
+presets store), its kind, range, default and the unit the editor shows. createParameterLayout(), the
+editor's knobs and attachments and getChainSettings() are all generated from the table, so an ID string is
+never repeated. The extra bands have their own generated IDs, see BandEngine.h.
+*/
+namespace Parameters
+{
+    enum ID
+    {
+        LowCutFreq,
+        HighCutFreq,
+        PeakFreq,
+        PeakGain,
+        PeakQuality,
+        LowCutSlope,
+        HighCutSlope,
+        PeakDynamic,
+        PeakSidechain,
+        PeakThreshold,
+        PeakRatio,
+        PeakAttack,
+        PeakRelease,
+        Bypass,
+        AutoGain,
+        NumParameters
+    };
+
+    enum class Kind { Float, Choice, Bool };
+
+    struct Spec
+    {
+        ID id;
+        const char* name;
+        Kind kind;
+        float minimum, maximum, interval, skew; //Float only
+        float defaultValue;                     //In the parameter's own range, the index of a Choice, 0 or 1 for a Bool
+        const char* unit;                       //Suffix the editor shows
+        const char* const* choices;             //Choice only
+        int numChoices;
+    };
+
+    inline constexpr const char* slopeChoices[] = { "12 dB/Oct", "24 dB/Oct", "36 dB/Oct", "48 dB/Oct" };
+
+    inline constexpr std::array<Spec, NumParameters> table
+    { {
+        { LowCutFreq,    "LowCut Freq",    Kind::Float,  20.f,  20000.f, 1.f,   0.25f, 20.f,    "Hz",     nullptr,      0 },
+        { HighCutFreq,   "HighCut Freq",   Kind::Float,  20.f,  20000.f, 1.f,   0.25f, 20000.f, "Hz",     nullptr,      0 },
+        { PeakFreq,      "Peak Freq",      Kind::Float,  20.f,  20000.f, 1.f,   0.25f, 750.f,   "Hz",     nullptr,      0 },
+        { PeakGain,      "Peak Gain",      Kind::Float,  -24.f, 24.f,    0.5f,  1.f,   0.f,     "dB",     nullptr,      0 },
+        { PeakQuality,   "Peak Quality",   Kind::Float,  0.1f,  10.f,    0.05f, 1.f,   1.f,     "",       nullptr,      0 },
+        { LowCutSlope,   "LowCut Slope",   Kind::Choice, 0.f,   0.f,     0.f,   1.f,   0.f,     "dB/Oct", slopeChoices, 4 },
+        { HighCutSlope,  "HighCut Slope",  Kind::Choice, 0.f,   0.f,     0.f,   1.f,   0.f,     "dB/Oct", slopeChoices, 4 },
+        { PeakDynamic,   "Peak Dynamic",   Kind::Bool,   0.f,   0.f,     0.f,   1.f,   0.f,     "",       nullptr,      0 },
+        { PeakSidechain, "Peak Sidechain", Kind::Bool,   0.f,   0.f,     0.f,   1.f,   0.f,     "",       nullptr,      0 },
+        { PeakThreshold, "Peak Threshold", Kind::Float,  -60.f, 0.f,     0.5f,  1.f,   -18.f,   "dB",     nullptr,      0 },
+        { PeakRatio,     "Peak Ratio",     Kind::Float,  1.f,   20.f,    0.1f,  0.5f,  2.f,     "",       nullptr,      0 },
+        { PeakAttack,    "Peak Attack",    Kind::Float,  0.1f,  200.f,   0.1f,  0.4f,  10.f,    "ms",     nullptr,      0 },
+        { PeakRelease,   "Peak Release",   Kind::Float,  5.f,   2000.f,  1.f,   0.4f,  150.f,   "ms",     nullptr,      0 },
+        { Bypass,        "Bypass",         Kind::Bool,   0.f,   0.f,     0.f,   1.f,   0.f,     "",       nullptr,      0 }, //Also the host's bypass, see getBypassParameter()
+        { AutoGain,      "Auto Gain",      Kind::Bool,   0.f,   0.f,     0.f,   1.f,   0.f,     "",       nullptr,      0 }, //See AutoGain.h
+    } };
+
+    //So table[id] is the entry of id
+    constexpr bool isInIDOrder()
+    {
+        for (size_t i = 0; i < table.size(); ++i)
+            if (table[i].id != (ID)i)
+                return false;
+        return true;
+    }
+    static_assert(isInIDOrder(), "Parameters::table has to list the parameters in the order of Parameters::ID");
+
+    constexpr const char* getID(ID id) { return table[(size_t)id].name; }
+    constexpr const char* getUnit(ID id) { return table[(size_t)id].unit; }
+
+    //Settings of the session rather than of the sound: presets and the A/B/C/D slots leave them alone
+    constexpr bool isSessionOnly(ID id) { return id == Bypass || id == AutoGain; }
+    inline juce::StringArray getSessionOnlyIDs() { return { getID(Bypass), getID(AutoGain) }; }
+
+    //The table's parameters, in table order
+    void addToLayout(juce::AudioProcessorValueTreeState::ParameterLayout& layout);
+
+    /*
+    The parameters' atomic values, looked up by ID once when the processor is built. Reading one is a
+    relaxed load, typed by the table: float for a Float, int for a Choice, bool for a Bool.
+    Safe from any thread.
+    */
+    class Handles
+    {
+    public:
+        explicit Handles(juce::AudioProcessorValueTreeState& apvts);
+
+        template<ID id>
+        auto get() const
+        {
+            const auto value = values[(size_t)id]->load(std::memory_order_relaxed);
+            if constexpr (table[(size_t)id].kind == Kind::Bool)
+                return value > 0.5f;
+            else if constexpr (table[(size_t)id].kind == Kind::Choice)
+                return (int)value;
+            else
+                return value;
+        }
+
+    private:
+        std::array<std::atomic<float>*, NumParameters> values{};
+    };
+}
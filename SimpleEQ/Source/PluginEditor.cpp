@@ -10,66 +10,118 @@ void LookAndFeels::drawRotarySlider(Graphics& g, int x, int y, int width, int he
                                     float sliderPosProportional, float rotaryStartAngle,
                                     float rotaryEndAngle, Slider& slider)
 {
+    //Generic path for any slider using this look and feel. RotarySliderWithLabels doesn't come through here,
+    //it draws the same layers itself from its cached image.
     auto bounds = Rectangle<float>(x, y, width, height);
+    const int textHeight = 14;
 
+    drawRotarySliderFace(g, bounds);
+
+    jassert(rotaryStartAngle < rotaryEndAngle);
+
+    auto center = bounds.getCentre();
+    auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, rotaryStartAngle, rotaryEndAngle);
+    g.fillPath(createRotarySliderPointer(bounds, textHeight), AffineTransform::rotation(sliderAngRad, center.getX(), center.getY()));
+
+    g.setFont(textHeight);
+    auto text = slider.getTextFromValue(slider.getValue());
+    drawRotarySliderValue(g, center, text, g.getCurrentFont().getStringWidthFloat(text), textHeight);
+}
+
+void LookAndFeels::drawRotarySliderFace(Graphics& g, juce::Rectangle<float> bounds)
+{
     g.setColour(Colour(255u, 0u, 0u));
     g.fillEllipse(bounds);
 
     g.setColour(Colour(255u, 255u, 255u));
     g.drawEllipse(bounds, 1.f);
+}
 
-    if (auto* rswl = dynamic_cast<RotarySliderWithLabels*>(&slider))
-    {
-        auto center = bounds.getCentre();
+juce::Path LookAndFeels::createRotarySliderPointer(juce::Rectangle<float> bounds, int textHeight)
+{
+    auto center = bounds.getCentre();
 
-        Path p;
+    Path p;
 
-        Rectangle<float> r;
-        r.setLeft(center.getX() - 2);
-        r.setRight(center.getX() + 2);
-        r.setTop(bounds.getY());
-        r.setBottom(center.getY() - rswl->getTextHeight() * 1.5);
+    Rectangle<float> r;
+    r.setLeft(center.getX() - 2);
+    r.setRight(center.getX() + 2);
+    r.setTop(bounds.getY());
+    r.setBottom(center.getY() - textHeight * 1.5);
 
-        p.addRoundedRectangle(r, 2.f);
-        p.addRectangle(r);
+    p.addRoundedRectangle(r, 2.f);
+    p.addRectangle(r);
 
-        jassert(rotaryStartAngle < rotaryEndAngle);
+    return p;
+}
 
-        auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, rotaryStartAngle, rotaryEndAngle);
+void LookAndFeels::drawRotarySliderValue(Graphics& g, juce::Point<float> center, const juce::String& text, float textWidth, int textHeight)
+{
+    Rectangle<float> r;
+    r.setSize(textWidth + 4, textHeight + 2);
+    r.setCentre(center);
 
-        p.applyTransform(AffineTransform().rotated(sliderAngRad, center.getX(), center.getY()));
-       
-        g.fillPath(p);
+    g.setColour(Colours::black);
+    g.fillRect(r);
 
-        g.setFont(rswl->getTextHeight()); 
-        auto text = rswl->getDisplayString();
-        auto strWidth = g.getCurrentFont().getStringWidth(text);
+    g.setColour(Colours::white);
+    g.drawFittedText(text, r.toNearestInt(), juce::Justification::centred, 1);
+}
+
+//==============================================================================
+void RotarySliderWithLabels::paint(juce::Graphics& g)
+{
+    auto startAng = degreesToRadians(-45.f - 90.f);
+    auto endAng = degreesToRadians(45.f + 90.f);
 
-        r.setSize(strWidth + 4, rswl->getTextHeight() + 2);
-        r.setCentre(center);
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (staticLayer.isNull() || scale != staticLayerScale) //Only rebuilt after a resize or when the window moves to a display with another scale
+        renderStaticLayer(scale);
 
-        g.setColour(Colours::black);
-        g.fillRect(r);
+    g.drawImage(staticLayer, getLocalBounds().toFloat());
 
-        g.setColour(Colours::white);
-        g.drawFittedText(text, r.toNearestInt(), juce::Justification::centred, 1);
+    auto range = getRange();
+    auto center = getSliderBounds().toFloat().getCentre();
+
+    auto sliderPosProportional = (float)jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0); //Here is where we map our sliders. We turn our slider values into normalised values
+    auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, startAng, endAng);
+
+    g.setColour(Colour(255u, 255u, 255u));
+    g.fillPath(pointer, AffineTransform::rotation(sliderAngRad, center.getX(), center.getY()));
+
+    auto text = getDisplayString();
+    if (text != cachedText)
+    {
+        cachedText = text;
+        cachedTextWidth = valueFont.getStringWidthFloat(text);
     }
 
+    g.setFont(valueFont);
+    lnf.drawRotarySliderValue(g, center, cachedText, cachedTextWidth, getTextHeight());
 }
 
-//==============================================================================
-void RotarySliderWithLabels::paint(juce::Graphics& g)
+void RotarySliderWithLabels::resized()
+{
+    staticLayer = {};
+    pointer = lnf.createRotarySliderPointer(getSliderBounds().toFloat(), getTextHeight());
+}
+
+void RotarySliderWithLabels::renderStaticLayer(float scale)
 {
     auto startAng = degreesToRadians(-45.f - 90.f);
     auto endAng = degreesToRadians(45.f + 90.f);
 
-    auto range = getRange();
+    staticLayerScale = scale;
+    staticLayer = Image(Image::PixelFormat::ARGB,
+                        jmax(1, roundToInt(getWidth() * scale)),
+                        jmax(1, roundToInt(getHeight() * scale)),
+                        true);
 
-    auto sliderBounds = getSliderBounds();
+    Graphics g(staticLayer);
+    g.addTransform(AffineTransform::scale(scale)); //Draw in component coordinates, stored at device resolution
 
-    getLookAndFeel().drawRotarySlider(g, sliderBounds.getX(), sliderBounds.getY(), sliderBounds.getWidth(), sliderBounds.getHeight(), 
-                                      jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0), //Here is where we map our sliders. We turn our slider values into normalised values
-                                      startAng, endAng, *this);
+    auto sliderBounds = getSliderBounds();
+    lnf.drawRotarySliderFace(g, sliderBounds.toFloat());
 
     auto center = sliderBounds.toFloat().getCentre();
     auto radius = sliderBounds.getWidth() * 0.5f;
@@ -116,24 +168,21 @@ juce::Rectangle<int> RotarySliderWithLabels::getSliderBounds() const
 juce::String RotarySliderWithLabels::getDisplayString() const
 {
     //return juce::String(getValue());
-    if (auto* choiceParam = dynamic_cast<juce::AudioParameterChoice*>(param))
+    if (choiceParam != nullptr)
         return choiceParam->getCurrentChoiceName();
 
     juce::String str;
     bool addK = false;
 
-    if (auto* floatParam = dynamic_cast<juce::AudioParameterFloat*>(param))
-    {
-        float val = getValue();
+    float val = getValue();
 
-        if (val > 999.f)
-        {
-            val /= 1000.f; //1001 / 100 = 1.001
-                addK = true;
-        }
-
-        str = juce::String(val, (addK ? 2 : 0));
+    if (val > 999.f)
+    {
+        val /= 1000.f; //1001 / 100 = 1.001
+            addK = true;
     }
+
+    str = juce::String(val, (addK ? 2 : (getInterval() < 1.0 && std::abs(val) < 10.f ? 1 : 0))); //0.1 ms attack, 2.5 ratio
     //else
     //{
     //    jassertfalse; //this shouldn't happen!
@@ -153,9 +202,8 @@ juce::String RotarySliderWithLabels::getDisplayString() const
 }
 //==============================================================================
 
-ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) : audioProcessor(p), 
-                                            /*leftChannelFifo(&audioProcessor.leftChannelFifo) */ leftPathProducer(audioProcessor.leftChannelFifo), 
-                                                                                                  rightPathProducer(audioProcessor.rightChannelFifo)
+ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) : audioProcessor(p)
+                                            /*leftChannelFifo(&audioProcessor.leftChannelFifo) */ //The path producers are created on the first timer tick, see createPathProducers()
 {
 
     const auto& params = audioProcessor.getParameters();
@@ -166,11 +214,18 @@ ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) : audi
 
     updateChain(); //Loading the previous configuration I want see that already drawn in the curve. Thats why I use this here
 
-    startTimerHz(60);
+    scheduler->addClient(this);
 }
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
+    scheduler->removeClient(this);
+
+    if (leftPathProducer != nullptr)
+        audioProcessor.removeAnalyserConsumer();
+    if (prePostAnalyser != nullptr)
+        audioProcessor.removePreEQConsumer();
+
     const auto& params = audioProcessor.getParameters();
     for (auto param : params)
     {
@@ -183,18 +238,183 @@ void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float new
     parametersChanged.set(true);
 }
 
+SpectrogramImage::SpectrogramImage()
+{
+    //Black through blue and red to pale yellow, so loudness reads as brightness
+    juce::ColourGradient gradient(Colours::black, 0.f, 0.f, Colour(255u, 250u, 200u), 1.f, 0.f, false);
+    gradient.addColour(0.35, Colour(40u, 20u, 120u));
+    gradient.addColour(0.65, Colour(200u, 40u, 60u));
+    gradient.addColour(0.85, Colour(250u, 160u, 30u));
+
+    for (size_t i = 0; i < colours.size(); ++i)
+        colours[i] = gradient.getColourAtPosition((double)i / (double)(colours.size() - 1)).getPixelARGB();
+}
+
+void SpectrogramImage::setSize(int numColumns, int numRows)
+{
+    if (numColumns <= 0 || numRows <= 0)
+    {
+        image = {};
+        return;
+    }
+
+    image = Image(Image::ARGB, numColumns, numRows, true, SoftwareImageType());
+    writeColumn = 0;
+    mappedFFTSize = 0; //The rows changed
+}
+
+void SpectrogramImage::updateRowBins(int fftSize, double sampleRate)
+{
+    const auto numRows = image.getHeight();
+    const auto numBins = fftSize / 2;
+    const auto binWidth = sampleRate / (double)fftSize;
+
+    rowBins.resize((size_t)numRows);
+    for (int row = 0; row < numRows; ++row)
+    {
+        //Each row covers a slice of the log axis: the low rows share a bin, the high ones take the loudest of many
+        auto top = mapToLog10(1.0 - (double)row / numRows, 20.0, 20000.0);
+        auto bottom = mapToLog10(1.0 - (double)(row + 1) / numRows, 20.0, 20000.0);
+        auto first = jlimit(0, numBins - 1, (int)(bottom / binWidth + 0.5));
+        auto last = jlimit(first, numBins - 1, (int)(top / binWidth + 0.5));
+        rowBins[(size_t)row] = { first, last };
+    }
+
+    mappedFFTSize = fftSize;
+    mappedSampleRate = sampleRate;
+}
+
+void SpectrogramImage::addFrame(const std::vector<float>& decibels, int fftSize, double sampleRate, float negativeInfinity)
+{
+    if (image.isNull())
+        return;
+
+    if (fftSize != mappedFFTSize || sampleRate != mappedSampleRate)
+        updateRowBins(fftSize, sampleRate);
+
+    const auto scale = (float)(colours.size() - 1) / -negativeInfinity;
+    Image::BitmapData column(image, writeColumn, 0, 1, image.getHeight(), Image::BitmapData::writeOnly);
+
+    for (int row = 0; row < image.getHeight(); ++row)
+    {
+        const auto bins = rowBins[(size_t)row];
+        auto level = decibels[(size_t)bins.first];
+        for (int bin = bins.first + 1; bin <= bins.last; ++bin)
+            level = jmax(level, decibels[(size_t)bin]);
+
+        const auto index = jlimit(0, (int)colours.size() - 1, (int)((level - negativeInfinity) * scale));
+        *reinterpret_cast<PixelARGB*>(column.getPixelPointer(0, row)) = colours[(size_t)index];
+    }
+
+    writeColumn = (writeColumn + 1) % image.getWidth();
+}
+
+void SpectrogramImage::draw(juce::Graphics& g, juce::Rectangle<float> area) const
+{
+    if (image.isNull())
+        return;
+
+    //The scroll is just where the ring is cut: [writeColumn, width) is the oldest part and goes on the left
+    const auto width = image.getWidth(), height = image.getHeight();
+    const auto olderWidth = width - writeColumn;
+    const auto columnWidth = area.getWidth() / (float)width;
+
+    g.drawImage(image, (int)area.getX(), (int)area.getY(), roundToInt(olderWidth * columnWidth), (int)area.getHeight(),
+                writeColumn, 0, olderWidth, height);
+
+    if (writeColumn > 0)
+        g.drawImage(image, (int)area.getX() + roundToInt(olderWidth * columnWidth), (int)area.getY(),
+                    (int)area.getWidth() - roundToInt(olderWidth * columnWidth), (int)area.getHeight(),
+                    0, 0, writeColumn, height);
+}
+
+void AnalyserSpans::updateColumnBins(int fftSize, double sampleRate)
+{
+    const auto width = mappedArea.getWidth();
+    const auto numBins = fftSize / 2;
+    const auto binWidth = sampleRate / (double)fftSize;
+
+    columnBins.resize((size_t)width);
+    for (int x = 0; x < width; ++x)
+    {
+        //Same log axis as AnalyserPathGenerator: bin k sits at k * binWidth
+        auto low = mapToLog10((double)x / width, 20.0, 20000.0);
+        auto high = mapToLog10((double)(x + 1) / width, 20.0, 20000.0);
+        auto first = (int)std::ceil(low / binWidth);
+        auto last = jmin(numBins - 1, (int)std::ceil(high / binWidth) - 1);
+
+        if (first <= last)
+        {
+            columnBins[(size_t)x] = { first, last, -1.f };
+        }
+        else
+        {
+            auto position = mapToLog10(((double)x + 0.5) / width, 20.0, 20000.0) / binWidth;
+            auto bin = jlimit(0, numBins - 2, (int)position);
+            columnBins[(size_t)x] = { bin, bin + 1, jlimit(0.f, 1.f, (float)(position - bin)) };
+        }
+    }
+
+    levelY.resize((size_t)width);
+    spanTop.resize((size_t)width);
+    spanBottom.resize((size_t)width);
+    mappedFFTSize = fftSize;
+    mappedSampleRate = sampleRate;
+}
+
+void AnalyserSpans::build(const std::vector<float>& decibels, juce::Rectangle<int> area, int fftSize, double sampleRate, float bottomLevel, float topLevel)
+{
+    if (area != mappedArea || fftSize != mappedFFTSize || sampleRate != mappedSampleRate)
+    {
+        mappedArea = area;
+        updateColumnBins(fftSize, sampleRate);
+    }
+
+    const auto top = (float)area.getY(), bottom = (float)area.getBottom();
+    for (size_t x = 0; x < columnBins.size(); ++x)
+    {
+        const auto bins = columnBins[x];
+        auto level = decibels[(size_t)bins.first];
+
+        if (bins.fraction >= 0.f)
+            level += bins.fraction * (decibels[(size_t)bins.last] - level);
+        else
+            for (int bin = bins.first + 1; bin <= bins.last; ++bin)
+                level = jmax(level, decibels[(size_t)bin]);
+
+        levelY[x] = jlimit(top, bottom, jmap(level, bottomLevel, topLevel, bottom, top));
+    }
+
+    for (size_t x = 0; x < levelY.size(); ++x)
+    {
+        const auto previous = levelY[x > 0 ? x - 1 : 0];
+        spanTop[x] = jmin(levelY[x], previous);
+        spanBottom[x] = jmax(levelY[x], previous) + 1.f; //At least a pixel, like a 1 px stroke
+    }
+}
+
+void AnalyserSpans::draw(juce::Graphics& g) const
+{
+    for (size_t x = 0; x < spanTop.size(); ++x)
+        g.drawVerticalLine(mappedArea.getX() + (int)x, spanTop[x], spanBottom[x]);
+}
+
 void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
 {
     //Here we are going to coordinate the SingleChannelSampleFifo with the FFT DataGenerator with the Path Producer and with the GUI draw.
    //First is the SCSF. While there are buffer to pull, if we can pull a buffer we are going to send it to the FFT Data Generator
    //Fisrtly, we need a temporal buffer to pull in to:
     juce::AudioBuffer<float> tempIncomingBuffer;
+    bool gotNewAudio = false;
+
+    queueDepth = leftChannelFifo->getNumCompleteBufferAvailable();
+    maxQueueDepth = jmax(maxQueueDepth, queueDepth);
 
     while (leftChannelFifo->getNumCompleteBufferAvailable() > 0)
     {
-        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer))
+        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer, &newestCaptureTicks))
         {
-            auto size = tempIncomingBuffer.getNumSamples();
+            auto size = jmin(tempIncomingBuffer.getNumSamples(), monoBuffer.getNumSamples()); //Only the newest window's worth of a buffer longer than the FFT
             //SCSF
             //With this method, monoBuffer never change the size
             juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),     //Shifting over the Data
@@ -202,12 +422,18 @@ void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
                 monoBuffer.getNumSamples() - size);
 
             juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size), //Copying this to the end
-                tempIncomingBuffer.getReadPointer(0, 0),
+                tempIncomingBuffer.getReadPointer(0, tempIncomingBuffer.getNumSamples() - size),
                 size);
 
-            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
+            samplesUntilPrimed = jmax(0, samplesUntilPrimed - size);
+            gotNewAudio = true;
         }
     }
+
+    //Only the most recent path is ever displayed, so when several buffers were waiting (a client that
+    //skipped a few frames in the scheduler) we transform just the newest window instead of one per buffer
+    if (gotNewAudio && samplesUntilPrimed == 0)
+        leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f, newestCaptureTicks);
     /*
     if there are FFT dataBuffers to pull
     if we can pull a buffer
@@ -223,35 +449,240 @@ void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
     */
     const auto binWidth = sampleRate / (double)fftSize; //SampleRate is a double
 
+    bool gotFrame = false;
+    juce::int64 frameCaptureTicks = 0;
     while (leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0) //check if FFT has data blocks
     {
-        std::vector<float> fftData; //temporary vector to store the block data and later feed into the path producer
-        if (leftChannelFFTDataGenerator.getFFTData(fftData)) //pull one block
+        juce::int64 captureTicks = 0;
+        if (leftChannelFFTDataGenerator.getFFTData(fftBlock, &captureTicks)) //pull one block
         {
-            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f);
+            if (rendering == AnalyserRendering::Paths)
+                pathProducer.generatePath(fftBlock, fftBounds, fftSize, binWidth, -48.f, captureTicks);
+
+            if (spectrogram != nullptr)
+                spectrogram->addFrame(fftBlock, fftSize, sampleRate, -48.f);
+
+            gotFrame = true;
+            frameCaptureTicks = captureTicks;
         }
     }
 
+    //Spans are only ever shown for the newest frame, which is still in fftBlock
+    if (rendering == AnalyserRendering::Spans && gotFrame)
+    {
+        spans.build(fftBlock, fftBounds.toNearestInt(), fftSize, sampleRate, -48.f);
+        pathCaptureTicks = frameCaptureTicks;
+    }
+
     /*
     while there are paths that can be pull
     pull as many as we can
     because we want to display the most recent path
     */
 
+    bool pulledPath = false;
     while (pathProducer.getNumPathsAvailable())
     {
-        pathProducer.getPath(leftChannelFFTPath);
+        if (pulledPath) //The one pulled before never made it to the screen
+            ++supersededPaths;
+        pulledPath = pathProducer.getPath(leftChannelFFTPath, &pathCaptureTicks);
     }
 }
 
-void ResponseCurveComponent::timerCallback()
+PrePostAnalyser::PrePostAnalyser(PrePostSampleFifo<SimpleEQAudioProcessor::BlockType>& fifo) : prePostFifo(&fifo)
 {
-   
+    window.setSize(2, fftSize);
+    window.clear();
+
+    timeData.resize((size_t)fftSize);
+    frequencyData.resize((size_t)fftSize);
+    preDecibels.resize((size_t)fftSize / 2);
+    postDecibels.resize((size_t)fftSize / 2);
+    difference.assign((size_t)fftSize / 2, 0.f);
+
+    prePostFifo->discardAvailableBuffers();
+    samplesUntilPrimed = fftSize;
+}
+
+void PrePostAnalyser::process(juce::Rectangle<int> area, double sampleRate)
+{
+    juce::AudioBuffer<float> incoming;
+    bool gotNewAudio = false;
+
+    while (prePostFifo->getNumCompleteBufferAvailable() > 0)
+    {
+        if (prePostFifo->getAudioBuffer(incoming))
+        {
+            auto size = jmin(incoming.getNumSamples(), fftSize); //Shifted in like PathProducer's monoBuffer
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                juce::FloatVectorOperations::copy(window.getWritePointer(channel, 0), window.getReadPointer(channel, size), fftSize - size);
+                juce::FloatVectorOperations::copy(window.getWritePointer(channel, fftSize - size),
+                                                  incoming.getReadPointer(channel, incoming.getNumSamples() - size), size);
+            }
+
+            samplesUntilPrimed = jmax(0, samplesUntilPrimed - size);
+            gotNewAudio = true;
+        }
+    }
+
+    if (!gotNewAudio || samplesUntilPrimed > 0)
+        return;
+
+    const auto* pre = window.getReadPointer(0);
+    const auto* post = window.getReadPointer(1);
+    const auto* scaledWindow = tables->scaledWindow.data();
+    for (int i = 0; i < fftSize; ++i)
+        timeData[(size_t)i] = { pre[i] * scaledWindow[i], post[i] * scaledWindow[i] };
+
+    tables->fft.perform(timeData.data(), frequencyData.data(), false);
+
+    //A lower floor than the traces, so the difference holds up where the levels are below -48 dB
+    constexpr float floorLevel = -120.f;
+    SpectrumMath::pairToDecibels(frequencyData.data(), fftSize, preDecibels.data(), postDecibels.data(), floorLevel);
+
+    //Averaged over a few frames, the difference of two noisy spectra jumps around far more than either
+    const auto smoothing = hasDifference ? 0.3f : 1.f;
+    for (size_t bin = 0; bin < difference.size(); ++bin)
+        difference[bin] += smoothing * (postDecibels[bin] - preDecibels[bin] - difference[bin]);
+    hasDifference = true;
+
+    preSpans.build(preDecibels, area, fftSize, sampleRate, -48.f);
+    differenceSpans.build(difference, area, fftSize, sampleRate, -24.f, 24.f);
+}
+
+void PrePostAnalyser::addMemoryUsage(MemoryReport& report) const
+{
+    report.add("Pre/Diff analyser", sizeof(*this) + MemoryUsage::of(window)
+                                    + MemoryUsage::of(timeData) + MemoryUsage::of(frequencyData)
+                                    + MemoryUsage::of(preDecibels) + MemoryUsage::of(postDecibels) + MemoryUsage::of(difference)
+                                    + preSpans.getMemoryUsage() + differenceSpans.getMemoryUsage());
+}
+
+AnalysisTables::AnalysisTables(FFTOrder order) : fftSize(1 << order), fft(order)
+{
+    //The same normalised Blackman-Harris as WindowingFunction, with the 1 / numBins of the magnitudes folded in
+    scaledWindow.assign((size_t)fftSize, 0.f);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(scaledWindow.data(), (size_t)fftSize,
+                                                             juce::dsp::WindowingFunction<float>::blackmanHarris, true);
+    juce::FloatVectorOperations::multiply(scaledWindow.data(), 2.f / (float)fftSize, fftSize);
+}
+
+size_t AnalysisTables::getMemoryUsage() const
+{
+    //juce::dsp::FFT doesn't say what it holds. Its fallback engine keeps a twiddle table of fftSize complex values
+    //per direction, close enough to what the platform engines allocate as well
+    return sizeof(*this) + MemoryUsage::of(scaledWindow) + 2 * (size_t)fftSize * sizeof(std::complex<float>);
+}
+
+std::shared_ptr<const AnalysisTables> AnalysisTables::get(FFTOrder order)
+{
+    //Weak, so the tables go away with the last open analyser instead of staying for the life of the process
+    static juce::CriticalSection lock;
+    static std::map<int, std::weak_ptr<const AnalysisTables>> cache;
+
+    const juce::ScopedLock sl(lock);
+    auto& entry = cache[(int)order];
+    auto tables = entry.lock();
+    if (tables == nullptr)
+    {
+        tables = std::make_shared<const AnalysisTables>(order);
+        entry = tables;
+    }
+    return tables;
+}
+
+void PathProducer::addMemoryUsage(MemoryReport& report, const juce::String& name) const
+{
+    report.add(name + " analyser", sizeof(*this) + MemoryUsage::of(monoBuffer)
+                                   + leftChannelFFTDataGenerator.getMemoryUsage() + pathProducer.getMemoryUsage()
+                                   + spans.getMemoryUsage() + MemoryUsage::of(fftBlock) + MemoryUsage::of(leftChannelFFTPath));
+}
+
+void PathProducer::addTelemetry(AnalyserTelemetry& telemetry) const
+{
+    telemetry.capturedBuffers += leftChannelFifo->getNumCapturedBuffers();
+    telemetry.droppedBuffers += leftChannelFifo->getNumDroppedBuffers();
+    telemetry.audioQueueDepth = jmax(telemetry.audioQueueDepth, queueDepth);
+    telemetry.maxAudioQueueDepth = jmax(telemetry.maxAudioQueueDepth, maxQueueDepth);
+    telemetry.fftFrames += leftChannelFFTDataGenerator.numFrames;
+    telemetry.droppedFFTFrames += leftChannelFFTDataGenerator.numDroppedFrames;
+    telemetry.paths += pathProducer.numPaths;
+    telemetry.droppedPaths += pathProducer.numDroppedPaths;
+    telemetry.supersededPaths += supersededPaths;
+}
+
+juce::String AnalyserTelemetry::toString() const
+{
+    return "audio " + juce::String(capturedBuffers) + " (" + juce::String(droppedBuffers) + " dropped, queue "
+         + juce::String(audioQueueDepth) + "/" + juce::String(maxAudioQueueDepth) + ")"
+         + "  fft " + juce::String(fftFrames) + " (" + juce::String(droppedFFTFrames) + " dropped)"
+         + "  paths " + juce::String(paths) + " (" + juce::String(droppedPaths) + " dropped, " + juce::String(supersededPaths) + " unseen)"
+         + "  latency " + juce::String(lastLatencyMs, 1) + " / avg " + juce::String(averageLatencyMs, 1) + " / max " + juce::String(maxLatencyMs, 1) + " ms";
+}
+
+AnalyserTelemetry ResponseCurveComponent::getAnalyserTelemetry() const
+{
+    AnalyserTelemetry telemetry;
+    if (leftPathProducer != nullptr)
+    {
+        leftPathProducer->addTelemetry(telemetry);
+        rightPathProducer->addTelemetry(telemetry);
+    }
+
+    telemetry.lastLatencyMs = lastLatencyMs;
+    telemetry.averageLatencyMs = averageLatencyMs;
+    telemetry.maxLatencyMs = maxLatencyMs;
+    return telemetry;
+}
+
+void ResponseCurveComponent::addMemoryUsage(MemoryReport& report) const
+{
+    report.add("response curve", sizeof(*this) + MemoryUsage::of(background) + spectrogram.getMemoryUsage());
+
+    if (leftPathProducer != nullptr)
+    {
+        leftPathProducer->addMemoryUsage(report, "left");
+        rightPathProducer->addMemoryUsage(report, "right");
+    }
+    if (prePostAnalyser != nullptr)
+        prePostAnalyser->addMemoryUsage(report);
+
+    //Every analyser uses the order 2048 tables, held once for all the instances
+    if (leftPathProducer != nullptr)
+        report.add("FFT tables", leftPathProducer->getTables().getMemoryUsage(), true);
+    else if (prePostAnalyser != nullptr)
+        report.add("FFT tables", prePostAnalyser->getTables().getMemoryUsage(), true);
+}
+
+void ResponseCurveComponent::createPathProducers()
+{
+    //Each PathProducer allocates its FFT, window and fifos. Doing that here instead of in the constructor
+    //lets the editor open and paint straight away, and the analyser starts one frame later.
+    auto startMs = Time::getMillisecondCounterHiRes();
+
+    leftPathProducer = std::make_unique<PathProducer>(audioProcessor.leftChannelFifo);
+    rightPathProducer = std::make_unique<PathProducer>(audioProcessor.rightChannelFifo);
+    leftPathProducer->setSpectrogram(spectrogramVisible ? &spectrogram : nullptr);
+    leftPathProducer->setRendering(analyserRendering);
+    rightPathProducer->setRendering(analyserRendering);
+    audioProcessor.addAnalyserConsumer(); //The audio thread starts filling the fifos from here on
+
+    analyserCreationMs = Time::getMillisecondCounterHiRes() - startMs;
+}
+
+void ResponseCurveComponent::serviceAnalyser()
+{
+    if (leftPathProducer == nullptr)
+        createPathProducers();
+
     auto fftBounds = getAnalysisArea().toFloat();
     auto sampleRate = audioProcessor.getSampleRate();
     
-    leftPathProducer.process(fftBounds, sampleRate);
-    rightPathProducer.process(fftBounds, sampleRate);
+    leftPathProducer->process(fftBounds, sampleRate);
+    rightPathProducer->process(fftBounds, sampleRate);
+    if (prePostAnalyser != nullptr)
+        prePostAnalyser->process(fftBounds.toNearestInt(), sampleRate);
 
 
     if (parametersChanged.compareAndSetBool(false, true))
@@ -263,19 +694,141 @@ void ResponseCurveComponent::timerCallback()
     repaint();
 }
 
+void ResponseCurveComponent::setSpectrogramVisible(bool shouldBeVisible)
+{
+    spectrogramVisible = shouldBeVisible;
+
+    //Starts over instead of showing a stale history, and holds no image while hidden
+    if (spectrogramVisible)
+        spectrogram.setSize(getAnalysisArea().getWidth(), getAnalysisArea().getHeight());
+    else
+        spectrogram.setSize(0, 0);
+
+    if (leftPathProducer != nullptr)
+        leftPathProducer->setSpectrogram(spectrogramVisible ? &spectrogram : nullptr);
+    repaint();
+}
+
+void ResponseCurveComponent::setPreEQVisible(bool shouldBeVisible)
+{
+    preEQVisible = shouldBeVisible;
+    updatePrePostAnalyser();
+}
+
+void ResponseCurveComponent::setDifferenceVisible(bool shouldBeVisible)
+{
+    differenceVisible = shouldBeVisible;
+    updatePrePostAnalyser();
+}
+
+void ResponseCurveComponent::updatePrePostAnalyser()
+{
+    const bool needed = preEQVisible || differenceVisible;
+    if (needed && prePostAnalyser == nullptr)
+    {
+        prePostAnalyser = std::make_unique<PrePostAnalyser>(audioProcessor.prePostFifo);
+        audioProcessor.addPreEQConsumer();
+    }
+    else if (!needed && prePostAnalyser != nullptr)
+    {
+        audioProcessor.removePreEQConsumer();
+        prePostAnalyser.reset();
+    }
+    repaint();
+}
+
+void ResponseCurveComponent::setAnalyserRendering(AnalyserRendering newRendering)
+{
+    analyserRendering = newRendering;
+
+    if (leftPathProducer != nullptr)
+    {
+        leftPathProducer->setRendering(analyserRendering);
+        rightPathProducer->setRendering(analyserRendering);
+    }
+}
+
+bool ResponseCurveComponent::isAnalyserVisible()
+{
+    auto* peer = getPeer();
+    return isShowing() && peer != nullptr && !peer->isMinimised();
+}
+
+bool ResponseCurveComponent::hasAnalyserPriority()
+{
+    auto* peer = getPeer();
+    return peer != nullptr && peer->isFocused();
+}
+
+//==============================================================================
+void AnalyserScheduler::addClient(Client* client)
+{
+    clients.addIfNotAlreadyThere(client);
+
+    if (!isTimerRunning())
+        startTimerHz(60);
+}
+
+void AnalyserScheduler::removeClient(Client* client)
+{
+    clients.removeFirstMatchingValue(client);
+
+    if (clients.isEmpty())
+        stopTimer();
+}
+
+void AnalyserScheduler::timerCallback()
+{
+    const auto frameStartMs = Time::getMillisecondCounterHiRes();
+    const auto numClients = clients.size();
+
+    //The focused editor is always serviced, even if that eats the whole budget
+    for (auto* client : clients)
+    {
+        if (client->hasAnalyserPriority() && client->isAnalyserVisible())
+            client->serviceAnalyser();
+    }
+
+    //The rest share what is left of the budget. Whoever didn't get a turn is first in line next frame
+    int visited = 0;
+    for (; visited < numClients; ++visited)
+    {
+        if (Time::getMillisecondCounterHiRes() - frameStartMs >= frameBudgetMs)
+            break;
+
+        auto* client = clients[(nextClient + visited) % numClients];
+        if (!client->hasAnalyserPriority() && client->isAnalyserVisible())
+            client->serviceAnalyser();
+    }
+
+    if (numClients > 0)
+        nextClient = (nextClient + visited) % numClients;
+}
+
 void ResponseCurveComponent::updateChain() //Helper function to have the curve drawn the first time that the plugin is load. (Because previous configuration keeps on from the previous time)
 {
     //update the monochain
-    auto chainSettings = getChainSettings(audioProcessor.apvts);
-    auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
+    auto chainSettings = getChainSettings(audioProcessor.parameters);
+    auto& cache = audioProcessor.getCoefficientCache(); //The processor has usually designed these already
+    auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate(), cache);
     //Now we can update our chain Coefficients:
     updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
 
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
+    CutCoefficients lowCutScratch, highCutScratch;
+    auto& lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate(), cache, lowCutScratch);
+    auto& highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate(), cache, highCutScratch);
 
     updateCutFilter(monoChain.get<ChainPositions::LowCut>(), lowCutCoefficients, chainSettings.lowCutSlope);
     updateCutFilter(monoChain.get<ChainPositions::HighCut>(), highCutCoefficients, chainSettings.highCutSlope);
+
+    //The Peak is left out like in the processor, so the curve shows what is actually heard
+    monoChain.setBypassed<ChainPositions::Peak>(!isPeakActive(chainSettings));
+
+    const auto sampleRate = audioProcessor.getSampleRate();
+    if (sampleRate > 0.0 && sampleRate != bands.getSampleRate())
+        bands.prepare(sampleRate);
+    for (int i = 0; i < BandEngine::MaxBands; ++i)
+        bands.setBand(i, audioProcessor.bandParameters.get(i));
 }
 
 void ResponseCurveComponent::paint(juce::Graphics& g)
@@ -286,6 +839,13 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
     g.drawImage(background, getLocalBounds().toFloat());
 
     auto responseArea = getAnalysisArea(); //getRenderArea(); //getLocalBounds();
+
+    if (spectrogramVisible)
+    {
+        g.setOpacity(0.85f); //The grid still shows through a little
+        spectrogram.draw(g, responseArea.toFloat());
+        g.setOpacity(1.f);
+    }
    
     auto w = responseArea.getWidth();
 
@@ -296,6 +856,7 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
 
     auto sampleRate = audioProcessor.getSampleRate(); //to use that function I need to know the sampleRate to get magnitude for frequency function
 
+    const auto autoGainDecibels = audioProcessor.getAutoGainDecibels(); //The curve as it sounds, with the Auto Gain compensation
     std::vector<double> mags; //I store all those magnitudes which return form that function as 'doubles'
     //We are computing one magnitude per pixel so let's pre-allocate the space that we need:
     mags.resize(w);
@@ -310,72 +871,118 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
         if (!monoChain.isBypassed<ChainPositions::Peak>()) //If the band is not bypassed  
             mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
 
-        if (!lowcut.isBypassed<0>())
-            mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!lowcut.isBypassed<1>())
-            mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!lowcut.isBypassed<2>())
-            mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!lowcut.isBypassed<3>())
-            mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-        if (!highcut.isBypassed<0>())
-            mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!highcut.isBypassed<1>())
-            mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!highcut.isBypassed<2>())
-            mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!highcut.isBypassed<3>())
-            mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+        if (!monoChain.isBypassed<ChainPositions::LowCut>())
+        {
+            if (!lowcut.isBypassed<0>())
+                mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!lowcut.isBypassed<1>())
+                mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!lowcut.isBypassed<2>())
+                mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!lowcut.isBypassed<3>())
+                mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+        }
+
+        if (!monoChain.isBypassed<ChainPositions::HighCut>())
+        {
+            if (!highcut.isBypassed<0>())
+                mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!highcut.isBypassed<1>())
+                mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!highcut.isBypassed<2>())
+                mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!highcut.isBypassed<3>())
+                mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+        }
+
+        mag *= bands.getMagnitudeForFrequency(freq); //The extra bands that are enabled
 
         //Convert this magnitude into decibels and store it:
-        mags[i] = Decibels::gainToDecibels(mag);
+        mags[i] = Decibels::gainToDecibels(mag) + autoGainDecibels;
+    }
 
-        //Now we convert this vector of magnitudes into a path and then  draw it:
-        Path responseCurve;
+    //Now we convert this vector of magnitudes into a path and then  draw it:
+    Path responseCurve;
 
-        //Map our decibel value to the response area:
-        const double outputMin = responseArea.getBottom(); //Define our maximun and minimun position in the window
-        const double outputMax = responseArea.getY();
-        auto map = [outputMin, outputMax](double input)
-        {
-            return jmap(input, -24.0, 24.0, outputMin, outputMax);
-        };
+    //Map our decibel value to the response area:
+    const double outputMin = responseArea.getBottom(); //Define our maximun and minimun position in the window
+    const double outputMax = responseArea.getY();
+    auto map = [outputMin, outputMax](double input)
+    {
+        return jmap(input, -24.0, 24.0, outputMin, outputMax);
+    };
 
-        //Start a new subpath with the first magnitude:
-        responseCurve.startNewSubPath(responseArea.getX(), map(mags.front()));
+    //Start a new subpath with the first magnitude:
+    responseCurve.startNewSubPath(responseArea.getX(), map(mags.front()));
 
-        //Now create lines for every other magnitude:
-        for (size_t i = 1; i < mags.size(); i++)
+    //Now create lines for every other magnitude:
+    for (size_t i = 1; i < mags.size(); i++)
+    {
+        responseCurve.lineTo(responseArea.getX() + i, map(mags[i]));
+    }
+
+    if (leftPathProducer != nullptr) //Not created until the first timer tick
+    {
+        auto captureTicks = leftPathProducer->getPathCaptureTicks();
+        if (captureTicks != 0 && captureTicks != lastPaintedCaptureTicks) //First time this path is on screen
         {
-            responseCurve.lineTo(responseArea.getX() + i, map(mags[i]));
+            lastPaintedCaptureTicks = captureTicks;
+            lastLatencyMs = 1000.0 * Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - captureTicks);
+            averageLatencyMs = averageLatencyMs == 0.0 ? lastLatencyMs : averageLatencyMs + 0.05 * (lastLatencyMs - averageLatencyMs);
+            maxLatencyMs = jmax(maxLatencyMs, lastLatencyMs);
         }
 
-        auto leftChannelFFTPath = leftPathProducer.getPath();
-        //Draw our frequency analysis before we draw our renderer area
-
-        //We need our pathGenerator taking in account the origin of the rectangle that defines the Analysis bounding box. 
-       // leftChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY())); //This is getting the blue line in the eadge bottom of the analyser
-        leftChannelFFTPath.scaleToFit(responseArea.getX(), responseArea.getY(), responseArea.getWidth(), responseArea.getHeight(), true);
-        g.setColour(Colours::skyblue);
-        g.strokePath(leftChannelFFTPath, PathStrokeType(1.f));
-
-        auto rightChannelFFTPath = rightPathProducer.getPath();
-        rightChannelFFTPath.scaleToFit(responseArea.getX(), responseArea.getY(), responseArea.getWidth(), responseArea.getHeight(), true);
-        g.setColour(Colours::lightyellow);
-        g.strokePath(rightChannelFFTPath, PathStrokeType(1.f));
+        if (analyserRendering == AnalyserRendering::Spans)
+        {
+            g.setColour(Colours::skyblue);
+            leftPathProducer->getSpans().draw(g);
+            g.setColour(Colours::lightyellow);
+            rightPathProducer->getSpans().draw(g);
+        }
+        else
+        {
+            auto leftChannelFFTPath = leftPathProducer->getPath();
+            //Draw our frequency analysis before we draw our renderer area
+
+            //We need our pathGenerator taking in account the origin of the rectangle that defines the Analysis bounding box. 
+           // leftChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY())); //This is getting the blue line in the eadge bottom of the analyser
+            leftChannelFFTPath.scaleToFit(responseArea.getX(), responseArea.getY(), responseArea.getWidth(), responseArea.getHeight(), true);
+            g.setColour(Colours::skyblue);
+            g.strokePath(leftChannelFFTPath, PathStrokeType(1.f));
+
+            auto rightChannelFFTPath = rightPathProducer->getPath();
+            rightChannelFFTPath.scaleToFit(responseArea.getX(), responseArea.getY(), responseArea.getWidth(), responseArea.getHeight(), true);
+            g.setColour(Colours::lightyellow);
+            g.strokePath(rightChannelFFTPath, PathStrokeType(1.f));
+        }
+    }
 
-        g.setColour(Colours::orange);
-        g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
+    if (prePostAnalyser != nullptr) //Always spans, whatever the channel traces use
+    {
+        if (preEQVisible)
+        {
+            g.setColour(Colours::lightgrey.withAlpha(0.8f));
+            prePostAnalyser->getPreSpans().draw(g);
+        }
+        if (differenceVisible)
+        {
+            g.setColour(Colours::limegreen);
+            prePostAnalyser->getDifferenceSpans().draw(g);
+        }
+    }
 
-        g.setColour(Colours::red);
-        g.strokePath(responseCurve, PathStrokeType(2.f));
+    g.setColour(Colours::orange);
+    g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
 
-    }
+    g.setColour(Colours::red);
+    g.strokePath(responseCurve, PathStrokeType(2.f));
 }
 
 void ResponseCurveComponent::resized()
 {
+    if (spectrogramVisible)
+        spectrogram.setSize(getAnalysisArea().getWidth(), getAnalysisArea().getHeight());
+
     background = Image(Image::PixelFormat::RGB, getWidth(), getHeight(), true);//Create a new background image.
     Graphics g(background); // Then create a graphics context which draw into the backgorund image
    
@@ -504,15 +1111,20 @@ juce::Rectangle<int> ResponseCurveComponent::getAnalysisArea()
 
 //==============================================================================
 SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p), 
-    peakFreqSlider(*audioProcessor.apvts.getParameter("Peak Freq"), "Hz"),
-    peakGainSlider(*audioProcessor.apvts.getParameter("Peak Gain"), "dB"),
-    peakQualitySlider(*audioProcessor.apvts.getParameter("Peak Quality"), ""),
-    lowCutFreqSlider(*audioProcessor.apvts.getParameter("LowCut Freq"), "Hz"),
-    highCutFreqSlider(*audioProcessor.apvts.getParameter("HighCut Freq"), "Hz"),
-    lowCutSlopeSlider(*audioProcessor.apvts.getParameter("LowCut Slope"), "dB/Oct"),
-    highCutSlopeSlider(*audioProcessor.apvts.getParameter("HighCut Slope"), "dB/Oct"),
-    responseCurveComponent(audioProcessor)
+    : AudioProcessorEditor(&p), audioProcessor(p), openStartMs(Time::getMillisecondCounterHiRes()),
+    peakFreqSlider(audioProcessor.apvts, Parameters::PeakFreq),
+    peakGainSlider(audioProcessor.apvts, Parameters::PeakGain),
+    peakQualitySlider(audioProcessor.apvts, Parameters::PeakQuality),
+    lowCutFreqSlider(audioProcessor.apvts, Parameters::LowCutFreq),
+    highCutFreqSlider(audioProcessor.apvts, Parameters::HighCutFreq),
+    lowCutSlopeSlider(audioProcessor.apvts, Parameters::LowCutSlope),
+    highCutSlopeSlider(audioProcessor.apvts, Parameters::HighCutSlope),
+    peakThresholdSlider(audioProcessor.apvts, Parameters::PeakThreshold),
+    peakRatioSlider(audioProcessor.apvts, Parameters::PeakRatio),
+    peakAttackSlider(audioProcessor.apvts, Parameters::PeakAttack),
+    peakReleaseSlider(audioProcessor.apvts, Parameters::PeakRelease),
+    responseCurveComponent(audioProcessor),
+    timingOverlay(audioProcessor, responseCurveComponent)
    // peakFreakSliderAttachment(audioProcessor.apvts, "Peak Freq", peakFreakSlider),
    // peakGainSliderAttachment(audioProcessor.apvts, "Peak Gain", peakGainSlider),
    // peakQualitySliderAttachment(audioProcessor.apvts, "Peak Quality", peakQualitySlider),
@@ -531,14 +1143,12 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcesso
     {
         addAndMakeVisible(comp);
     }
-     peakFreqSliderAttachment = std::make_unique< juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "Peak Freq", peakFreqSlider);
-     peakGainSliderAttachment = std::make_unique< juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "Peak Gain", peakGainSlider);
-     peakQualitySliderAttachment = std::make_unique< juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "Peak Quality", peakQualitySlider);
-     lowCutFreqSliderAttachment = std::make_unique< juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "LowCut Freq", lowCutFreqSlider);
-     highCutFreqSliderAttachment = std::make_unique< juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "HighCut Freq", highCutFreqSlider);
-     lowCutSlopeSliderAttachment = std::make_unique< juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "LowCut Slope", lowCutSlopeSlider);
-     highCutSlopeSliderAttachment = std::make_unique< juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "HighCut Slope", highCutSlopeSlider);
-      
+     for (auto* slider : { &peakFreqSlider, &peakGainSlider, &peakQualitySlider, &lowCutFreqSlider, &highCutFreqSlider,
+                           &lowCutSlopeSlider, &highCutSlopeSlider,
+                           &peakThresholdSlider, &peakRatioSlider, &peakAttackSlider, &peakReleaseSlider })
+         sliderAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+             audioProcessor.apvts, Parameters::getID(slider->parameterID), *slider));
+
      peakFreqSlider.labels.add({ 0.f, "20hz" });
      peakFreqSlider.labels.add({ 1.f, "20KHz" });
      
@@ -560,29 +1170,185 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcesso
      highCutSlopeSlider.labels.add({ 0.f, "12" });
      highCutSlopeSlider.labels.add({ 1.f, "48" });
 
-    setSize(600, 400);
+     peakThresholdSlider.labels.add({ 0.f, "-60dB" });
+     peakThresholdSlider.labels.add({ 1.f, "0dB" });
+
+     peakRatioSlider.labels.add({ 0.f, "1:1" });
+     peakRatioSlider.labels.add({ 1.f, "20:1" });
+
+     peakAttackSlider.labels.add({ 0.f, "0.1ms" });
+     peakAttackSlider.labels.add({ 1.f, "200ms" });
+
+     peakReleaseSlider.labels.add({ 0.f, "5ms" });
+     peakReleaseSlider.labels.add({ 1.f, "2s" });
+
+     peakDynamicButton.setClickingTogglesState(true);
+     peakDynamicAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+         audioProcessor.apvts, Parameters::getID(Parameters::PeakDynamic), peakDynamicButton);
+     peakSidechainButton.setClickingTogglesState(true);
+     peakSidechainAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+         audioProcessor.apvts, Parameters::getID(Parameters::PeakSidechain), peakSidechainButton);
+
+    addChildComponent(timingOverlay); //Hidden until the CPU button is on
+    timingOverlay.setInterceptsMouseClicks(false, false);
+    timingButton.setClickingTogglesState(true);
+    timingButton.onClick = [this] { timingOverlay.setVisible(timingButton.getToggleState()); };
+    spectrogramButton.setClickingTogglesState(true);
+    spectrogramButton.onClick = [this] { responseCurveComponent.setSpectrogramVisible(spectrogramButton.getToggleState()); };
+    autoGainButton.setClickingTogglesState(true);
+    autoGainAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        audioProcessor.apvts, Parameters::getID(Parameters::AutoGain), autoGainButton);
+    preEQButton.setClickingTogglesState(true);
+    preEQButton.onClick = [this] { responseCurveComponent.setPreEQVisible(preEQButton.getToggleState()); };
+    differenceButton.setClickingTogglesState(true);
+    differenceButton.onClick = [this] { responseCurveComponent.setDifferenceVisible(differenceButton.getToggleState()); };
+
+    refreshPresetBox();
+    presetBox.onChange = [this]
+    {
+        auto index = presetBox.getSelectedItemIndex();
+        if (index >= 0 && index != audioProcessor.getCurrentProgram())
+            audioProcessor.setCurrentProgram(index);
+    };
+    savePresetButton.onClick = [this]
+    {
+        audioProcessor.savePreset("Preset " + juce::String(audioProcessor.getPresetBank().getNumPresets() + 1));
+    };
+
+    for (int i = 0; i < SimpleEQAudioProcessor::NumSlots; ++i)
+    {
+        auto& button = slotButtons[(size_t)i];
+        button.setButtonText(juce::String::charToString((juce::juce_wchar)('A' + i)));
+        button.setClickingTogglesState(true);
+        button.setRadioGroupId(1);
+        button.setToggleState(i == audioProcessor.getCurrentSlot(), juce::dontSendNotification);
+        button.onClick = [this, i]
+        {
+            if (slotButtons[(size_t)i].getToggleState())
+                audioProcessor.selectSlot(i);
+        };
+    }
+
+    audioProcessor.presetChanges.addChangeListener(this);
+
+    setSize(600, 480);
+
+    openTimings.constructionMs = Time::getMillisecondCounterHiRes() - openStartMs;
 }
 
 SimpleEQAudioProcessorEditor::~SimpleEQAudioProcessorEditor()
 {
-
+    audioProcessor.presetChanges.removeChangeListener(this);
 }
 //==============================================================================
 void SimpleEQAudioProcessorEditor::paint(juce::Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll(juce::Colours::black);
+
+    if (openTimings.firstPaintMs < 0.0) //The editor is painted before its children, so this is the first frame of the window
+        openTimings.firstPaintMs = Time::getMillisecondCounterHiRes() - openStartMs;
+}
+
+TimingOverlay::TimingOverlay(SimpleEQAudioProcessor& p, const ResponseCurveComponent& curve) : audioProcessor(p), responseCurve(curve)
+{
+}
+
+void TimingOverlay::visibilityChanged()
+{
+    if (isVisible())
+    {
+        timerCallback();
+        startTimerHz(4);
+    }
+    else
+    {
+        stopTimer();
+    }
+}
+
+void TimingOverlay::timerCallback()
+{
+    const auto memory = audioProcessor.getMemoryReport();
+    timingText = audioProcessor.getBlockTiming().toString() + "  biquads " + juce::String(audioProcessor.getNumActiveBiquads())
+               + "  mem " + MemoryReport::formatBytes(memory.getInstanceBytes()) + " (+" + MemoryReport::formatBytes(memory.getSharedBytes()) + " shared)";
+    analyserText = responseCurve.getAnalyserTelemetry().toString();
+    repaint();
+}
+
+void TimingOverlay::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::black.withAlpha(0.6f));
+    g.setColour(juce::Colours::lightgreen);
+    g.setFont(11);
+    auto bounds = getLocalBounds();
+    g.drawFittedText(timingText, bounds.removeFromTop(bounds.getHeight() / 2), juce::Justification::centredLeft, 1);
+    g.drawFittedText(analyserText, bounds, juce::Justification::centredLeft, 1);
+}
+
+void SimpleEQAudioProcessorEditor::refreshPresetBox()
+{
+    presetBox.clear(juce::dontSendNotification);
+
+    auto& bank = audioProcessor.getPresetBank();
+    for (int i = 0; i < bank.getNumPresets(); ++i)
+        presetBox.addItem(bank.getName(i), i + 1);
+
+    presetBox.setSelectedItemIndex(audioProcessor.getCurrentProgram(), juce::dontSendNotification);
+
+    for (int i = 0; i < SimpleEQAudioProcessor::NumSlots; ++i)
+        slotButtons[(size_t)i].setToggleState(i == audioProcessor.getCurrentSlot(), juce::dontSendNotification);
+}
+
+void SimpleEQAudioProcessorEditor::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    refreshPresetBox();
+}
+
+SimpleEQAudioProcessorEditor::OpenTimings SimpleEQAudioProcessorEditor::getOpenTimings() const
+{
+    auto timings = openTimings;
+    timings.analyserCreationMs = responseCurveComponent.getAnalyserCreationMs();
+    return timings;
 }
 void SimpleEQAudioProcessorEditor::resized()
 {
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
     auto bounds = getLocalBounds();
+
+    auto presetArea = bounds.removeFromTop(24).reduced(2);
+    for (int i = SimpleEQAudioProcessor::NumSlots - 1; i >= 0; --i)
+        slotButtons[(size_t)i].setBounds(presetArea.removeFromRight(24));
+    presetArea.removeFromRight(8);
+    savePresetButton.setBounds(presetArea.removeFromRight(50));
+    presetArea.removeFromRight(8);
+    timingButton.setBounds(presetArea.removeFromRight(40));
+    presetArea.removeFromRight(4);
+    spectrogramButton.setBounds(presetArea.removeFromRight(40));
+    presetArea.removeFromRight(4);
+    autoGainButton.setBounds(presetArea.removeFromRight(40));
+    presetArea.removeFromRight(4);
+    differenceButton.setBounds(presetArea.removeFromRight(36));
+    preEQButton.setBounds(presetArea.removeFromRight(36));
+    presetBox.setBounds(presetArea.removeFromLeft(200));
+
     auto responseArea = bounds.removeFromTop(bounds.getHeight() * 0.33);
     responseCurveComponent.setBounds(responseArea);
+    timingOverlay.setBounds(responseArea.removeFromTop(30).reduced(4, 0));
     
     bounds.removeFromTop(5);
 
+    auto dynamicsArea = bounds.removeFromBottom(80);
+    auto dynamicsButtons = dynamicsArea.removeFromLeft(50).reduced(4, 8);
+    peakDynamicButton.setBounds(dynamicsButtons.removeFromTop(dynamicsButtons.getHeight() / 2).reduced(0, 2));
+    peakSidechainButton.setBounds(dynamicsButtons.reduced(0, 2));
+    const auto dynamicsKnobWidth = dynamicsArea.getWidth() / 4;
+    peakThresholdSlider.setBounds(dynamicsArea.removeFromLeft(dynamicsKnobWidth));
+    peakRatioSlider.setBounds(dynamicsArea.removeFromLeft(dynamicsKnobWidth));
+    peakAttackSlider.setBounds(dynamicsArea.removeFromLeft(dynamicsKnobWidth));
+    peakReleaseSlider.setBounds(dynamicsArea);
+
     auto lowCutArea = bounds.removeFromLeft(bounds.getWidth() * 0.33);
     auto highCutArea = bounds.removeFromRight(bounds.getWidth() * 0.5);
     lowCutFreqSlider.setBounds(lowCutArea.removeFromTop(lowCutArea.getHeight() * 0.5));
@@ -594,6 +1360,18 @@ void SimpleEQAudioProcessorEditor::resized()
     peakQualitySlider.setBounds(bounds);
 }
 
+void SimpleEQAudioProcessorEditor::addMemoryUsage(MemoryReport& report) const
+{
+    size_t sliderBytes = 0;
+    for (auto* slider : { &peakFreqSlider, &peakGainSlider, &peakQualitySlider, &lowCutFreqSlider, &highCutFreqSlider,
+                          &lowCutSlopeSlider, &highCutSlopeSlider,
+                          &peakThresholdSlider, &peakRatioSlider, &peakAttackSlider, &peakReleaseSlider })
+        sliderBytes += slider->getMemoryUsage();
+
+    report.add("editor", sizeof(*this) + sliderBytes); //The knobs' cached images included
+    responseCurveComponent.addMemoryUsage(report);
+}
+
 std::vector<juce::Component*> SimpleEQAudioProcessorEditor::getComps()
 {
     return
@@ -605,6 +1383,23 @@ std::vector<juce::Component*> SimpleEQAudioProcessorEditor::getComps()
         &highCutFreqSlider,
         &lowCutSlopeSlider,
         &highCutSlopeSlider,
-        &responseCurveComponent
+        &peakThresholdSlider,
+        &peakRatioSlider,
+        &peakAttackSlider,
+        &peakReleaseSlider,
+        &peakDynamicButton,
+        &peakSidechainButton,
+        &responseCurveComponent,
+        &presetBox,
+        &savePresetButton,
+        &timingButton,
+        &spectrogramButton,
+        &preEQButton,
+        &differenceButton,
+        &autoGainButton,
+        &slotButtons[0],
+        &slotButtons[1],
+        &slotButtons[2],
+        &slotButtons[3]
     };
 }
\ No newline at end of file
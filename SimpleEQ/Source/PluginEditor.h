@@ -6,6 +6,9 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SpectrumMath.h"
+#include <map>
+#include <memory>
 
 enum FFTOrder  //FFT Data Generator configuration
 {
@@ -14,68 +17,128 @@ enum FFTOrder  //FFT Data Generator configuration
     order8192 = 13
 };
 
+/*
+The FFT plan and window of one order, shared by every analyser in the process that uses that order: each
+FFTDataGenerator and PrePostAnalyser, of every instance. Both are read only once built (FFT's transforms
+are const and keep nothing between calls), so any thread can use them at the same time.
+*/
+struct AnalysisTables
+{
+    explicit AnalysisTables(FFTOrder order);
+
+    const int fftSize;
+    const juce::dsp::FFT fft;
+    std::vector<float> scaledWindow; //Never changed after the constructor
+
+    size_t getMemoryUsage() const; //The FFT's own tables are estimated
+
+    //Made on first use and freed when the last user lets go. Any thread
+    static std::shared_ptr<const AnalysisTables> get(FFTOrder order);
+};
+
+//16 bit frames (SpectrumMath's compact format) in the editor's FFT queues, half the memory of floats
+#ifndef SIMPLEEQ_COMPACT_ANALYSER_FRAMES
+ #define SIMPLEEQ_COMPACT_ANALYSER_FRAMES 1
+#endif
+
+#if SIMPLEEQ_COMPACT_ANALYSER_FRAMES
+using AnalyserFrame = std::vector<juce::int16>;
+#else
+using AnalyserFrame = std::vector<float>;
+#endif
+
+/*
+BlockType is what a frame is queued as: std::vector<float>, or std::vector<juce::int16> for the compact
+format. Either way frames come out of getFFTData() as numBins floats in dB.
+*/
 template<typename BlockType>
 struct FFTDataGenerator
 {
+    static constexpr bool isCompact = std::is_same_v<BlockType, std::vector<juce::int16>>;
+    static_assert(isCompact || std::is_same_v<BlockType, std::vector<float>>, "Frames are float or compact dB");
+
+    //The editor and the tools pull every frame straight after producing it, so one waiting frame is plenty
+    static constexpr int DefaultQueueDepth = 2;
+
     /** produces the FFT data form an audio buffer */
-    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity) //Feed audio to the FFT
+    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity, juce::int64 captureTicks = 0) //Feed audio to the FFT
     {
         const auto fftSize = getFFTSize();
+        const int numBins = fftSize / 2;
 
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
+        //Copy, window and normalise in one multiply. The FFT only reads the first half of fftData,
+        //the second half is its workspace, so it doesn't have to be cleared first
+        juce::FloatVectorOperations::multiply(fftData.data(), audioData.getReadPointer(0), tables->scaledWindow.data(), fftSize);
 
-        //First apply a windowing function to our data
-        window->multiplyWithWindowingTable(fftData.data(), fftSize);
+        tables->fft.performRealOnlyForwardTransform(fftData.data(), true);
 
-        //then render our FFT data..
-        forwardFFT->performFrequencyOnlyForwardTransform(fftData.data());
-
-        int numBins = (int)fftSize / 2;
-
-        //normalise the fft values
-        for (int i = 0; i < numBins; ++i)
+        //Complex bins straight to decibels, see SpectrumMath.h
+        if constexpr (isCompact)
         {
-            fftData[i] /= (float)numBins;
+            SpectrumMath::complexToDecibels(fftData.data(), decibels.data(), numBins, negativeInfinity);
+            SpectrumMath::decibelsToCompact(decibels.data(), frame.data(), numBins);
         }
-
-        //convert them to decibels
-        for (int i = 0; i < numBins; ++i)
+        else
         {
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
+            SpectrumMath::complexToDecibels(fftData.data(), frame.data(), numBins, negativeInfinity);
         }
 
-        fftDataFifo.push(fftData);
+        if (fftDataFifo.push(frame, captureTicks))
+            ++numFrames;
+        else
+            ++numDroppedFrames;
     }
 
-    void changeOrder(FFTOrder newOrder)
+    void changeOrder(FFTOrder newOrder, int queueDepth = DefaultQueueDepth)
     {
-        //When you change order, recreate the window, dorwardFFT, fifo, fftData
-        //also reset the fifoIndex
-        //things that need recreating should be created on the heap via st::make_unique<>
+        //When you change order, the tables, fftData, frames and fifo change size with it.
+        //The window and the FFT come from the shared AnalysisTables instead of being made here
 
         order = newOrder;
-        auto fftSize = getFFTSize();
-
-        forwardFFT = std::make_unique<juce::dsp::FFT>(order);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
+        tables = AnalysisTables::get(order);
+        const auto fftSize = getFFTSize();
 
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
+        fftData.assign((size_t)fftSize * 2, 0.f);
+        frame.assign((size_t)fftSize / 2, {}); //Only numBins, not the whole FFT buffer
+        if constexpr (isCompact)
+            decibels.assign((size_t)fftSize / 2, 0.f);
 
-        fftDataFifo.prepare(fftData.size());
+        fftDataFifo.prepare((size_t)fftSize / 2, queueDepth);
     }
     //==============================================================================
     int getFFTSize() const { return 1 << order; } 
     int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); } //Here we see ho much FFT data we have
     //==============================================================================
-    bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); } //Here is where we get our FFT data available
+    bool getFFTData(std::vector<float>& fftData, juce::int64* captureTicks = nullptr) //Here is where we get our FFT data available
+    {
+        if constexpr (isCompact)
+        {
+            if (!fftDataFifo.pull(pulled, captureTicks))
+                return false;
+            fftData.resize(pulled.size());
+            SpectrumMath::compactToDecibels(pulled.data(), fftData.data(), (int)pulled.size());
+            return true;
+        }
+        else
+        {
+            return fftDataFifo.pull(fftData, captureTicks);
+        }
+    }
+
+    const AnalysisTables& getTables() const { return *tables; }
+    size_t getMemoryUsage() const //Not counting the shared tables
+    {
+        return MemoryUsage::of(fftData) + MemoryUsage::of(frame) + MemoryUsage::of(decibels) + MemoryUsage::of(pulled)
+             + fftDataFifo.getMemoryUsage();
+    }
+
+    juce::uint64 numFrames = 0, numDroppedFrames = 0; //Dropped: the fifo was full
 private:
     FFTOrder order;
-    BlockType fftData;
-    std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
+    std::shared_ptr<const AnalysisTables> tables;
+    std::vector<float> fftData; //FFT input and workspace
+    BlockType frame, pulled;    //What goes into the fifo, and what comes out of it (compact only)
+    std::vector<float> decibels; //Compact only, the levels before they are packed
 
     Fifo<BlockType> fftDataFifo;
 };
@@ -84,13 +147,16 @@ private:
 template<typename PathType>
 struct AnalyserPathGenerator
 {
+    AnalyserPathGenerator() { pathFifo.setDepth(2); } //Pulled as soon as it's made, like the FFT frames
+
     /*
     converts 'renderdata[]' into a juce::Path 
     */
     void generatePath(const std::vector<float>& renderData,
                       juce::Rectangle<float> fftBounds,
                       int fftSize, float binWidth,
-                      float negativeInfinity)
+                      float negativeInfinity,
+                      juce::int64 captureTicks = 0)
     {
         auto top = fftBounds.getY();
         auto bottom = fftBounds.getHeight();
@@ -126,7 +192,10 @@ struct AnalyserPathGenerator
                 p.lineTo(binX, y);
             }
         }
-        pathFifo.push(p);
+        if (pathFifo.push(p, captureTicks))
+            ++numPaths;
+        else
+            ++numDroppedPaths;
     }
     
     int getNumPathsAvailable() const
@@ -134,31 +203,111 @@ struct AnalyserPathGenerator
         return pathFifo.getNumAvailableForReading();
     }
 
-    bool getPath(PathType& path)
+    bool getPath(PathType& path, juce::int64* captureTicks = nullptr)
     {
-        return pathFifo.pull(path);
+        return pathFifo.pull(path, captureTicks);
     }
 
+    size_t getMemoryUsage() const { return pathFifo.getMemoryUsage(); }
+
+    juce::uint64 numPaths = 0, numDroppedPaths = 0; //Dropped: the fifo was full
 private:
     Fifo<PathType> pathFifo;
 };
 
+/*
+Scrolling spectrogram of the analyser's FFT frames: time along x, newest on the right, and 20 Hz to 20 kHz up y.
+The history is a ring of columns in one image: a new frame only colours its own column, through a
+row -> bins map and a colour table that are both worked out in advance, and draw() blits the ring in
+two pieces, oldest first. Neither depends on how much history is kept.
+*/
+struct SpectrogramImage
+{
+    SpectrogramImage();
+
+    void setSize(int numColumns, int numRows); //One column per frame. Clears the history
+    void addFrame(const std::vector<float>& decibels, int fftSize, double sampleRate, float negativeInfinity);
+    void draw(juce::Graphics& g, juce::Rectangle<float> area) const;
+    size_t getMemoryUsage() const { return MemoryUsage::of(image) + MemoryUsage::of(rowBins); }
+
+private:
+    juce::Image image; //Software, so columns can be written straight into its pixels
+    int writeColumn = 0; //Next column to overwrite, which is also the oldest one
+
+    struct BinRange { int first, last; };
+    std::vector<BinRange> rowBins; //FFT bins that fall into each row, top row first
+    int mappedFFTSize = 0;
+    double mappedSampleRate = 0.0;
+    void updateRowBins(int fftSize, double sampleRate);
+
+    std::array<juce::PixelARGB, 256> colours; //Quietest first
+};
+
+enum class AnalyserRendering
+{
+    Spans, //AnalyserSpans: a vertical run of pixels per column
+    Paths  //AnalyserPathGenerator: a juce::Path, scaled and stroked in paint()
+};
+
+/*
+An analyser trace as one vertical span of pixels per column of the analysis area, in component
+coordinates. Built once per FFT frame through a column -> bins map that only changes with the
+size, the FFT size or the sample rate; paint() just draws a vertical line per column, so there
+are no Path copies, transforms or stroking per frame. Each span reaches to the level of the
+column before it, so the trace stays joined where it moves steeply.
+*/
+struct AnalyserSpans
+{
+    //'bottomLevel' and 'topLevel' are the dB at the bottom and top of 'area'
+    void build(const std::vector<float>& decibels, juce::Rectangle<int> area, int fftSize, double sampleRate, float bottomLevel, float topLevel = 0.f);
+    void draw(juce::Graphics& g) const;
+    size_t getMemoryUsage() const
+    {
+        return MemoryUsage::of(columnBins) + MemoryUsage::of(levelY) + MemoryUsage::of(spanTop) + MemoryUsage::of(spanBottom);
+    }
+
+private:
+    juce::Rectangle<int> mappedArea;
+    int mappedFFTSize = 0;
+    double mappedSampleRate = 0.0;
+
+    //A column narrower than a bin interpolates between 'first' and the bin after it at 'fraction',
+    //a wider one takes the loudest of first..last (fraction < 0)
+    struct ColumnBins { int first, last; float fraction; };
+    std::vector<ColumnBins> columnBins;
+    void updateColumnBins(int fftSize, double sampleRate);
+
+    std::vector<float> levelY, spanTop, spanBottom; //Per column
+};
+
 struct LookAndFeels : juce::LookAndFeel_V4 
 {
     void drawRotarySlider(Graphics&, int x, int y, int width, int height,
         float sliderPosProportional, float rotaryStartAngle,
         float rotaryEndAngle, Slider&) override;
+
+    //The knob is split in layers so RotarySliderWithLabels can cache the static part in an image
+    void drawRotarySliderFace(Graphics&, juce::Rectangle<float> bounds);
+    juce::Path createRotarySliderPointer(juce::Rectangle<float> bounds, int textHeight);
+    void drawRotarySliderValue(Graphics&, juce::Point<float> center, const juce::String& text, float textWidth, int textHeight);
 };
 
 struct RotarySliderWithLabels : juce::Slider   //To dont type this base class initialisation for every slider, this class do this in the constructor. So I can use this for every slider in the GUI
 {
     RotarySliderWithLabels(juce::RangedAudioParameter& rap, const juce::String& unitSuffix) : juce::Slider(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag,
         juce::Slider::TextEntryBoxPosition::NoTextBox), 
-        param(&rap), suffix(unitSuffix)
+        param(&rap), choiceParam(dynamic_cast<juce::AudioParameterChoice*>(&rap)), suffix(unitSuffix)
     {
         setLookAndFeel(&lnf);
     }
 
+    //For one of the main parameters, with the unit from Parameters::table
+    RotarySliderWithLabels(juce::AudioProcessorValueTreeState& apvts, Parameters::ID id)
+        : RotarySliderWithLabels(*apvts.getParameter(Parameters::getID(id)), Parameters::getUnit(id))
+    {
+        parameterID = id;
+    }
+
     ~RotarySliderWithLabels()
     {
         setLookAndFeel(nullptr);
@@ -171,15 +320,44 @@ struct RotarySliderWithLabels : juce::Slider   //To dont type this base class in
     };
 
     juce::Array<LabelPos> labels;
+    Parameters::ID parameterID = Parameters::NumParameters; //Which main parameter it was made for, if any
 
     void paint(juce::Graphics& g) override;
+    void resized() override;
+    void lookAndFeelChanged() override { staticLayer = {}; }
     juce::Rectangle<int> getSliderBounds() const;
     int getTextHeight() const { return 14; }
     juce::String getDisplayString() const;
+    size_t getMemoryUsage() const { return MemoryUsage::of(staticLayer) + MemoryUsage::of(pointer); }
 
 private: juce::RangedAudioParameter* param;
+       juce::AudioParameterChoice* choiceParam = nullptr; //Resolved once in the constructor instead of casting on every repaint
        juce::String suffix;
        LookAndFeels lnf;
+
+       //Knob face and range labels only change with the bounds or the display scale, so they are rendered once into an image.
+       //A value change only has to draw the rotated pointer and the value text on top of it.
+       void renderStaticLayer(float scale);
+       juce::Image staticLayer;
+       float staticLayerScale = 0.f;
+       juce::Path pointer; //Unrotated pointer, rebuilt in resized()
+
+       juce::Font valueFont{ (float)getTextHeight() };
+       juce::String cachedText; //Last value text and its width, so the string is only measured when it changes
+       float cachedTextWidth = 0.f;
+};
+
+//Counters of the analyser pipeline, from the audio thread capture to the paint. Message thread
+struct AnalyserTelemetry
+{
+    juce::uint64 capturedBuffers = 0, droppedBuffers = 0; //Audio thread -> analyser fifos, both channels
+    int audioQueueDepth = 0, maxAudioQueueDepth = 0;      //Buffers waiting when the analyser was last serviced / at worst
+    juce::uint64 fftFrames = 0, droppedFFTFrames = 0;
+    juce::uint64 paths = 0, droppedPaths = 0;
+    juce::uint64 supersededPaths = 0;                     //Replaced by a newer path before they were ever painted
+    double lastLatencyMs = 0.0, averageLatencyMs = 0.0, maxLatencyMs = 0.0; //Capture of the newest audio in a path -> the paint showing it
+
+    juce::String toString() const;
 };
 
 struct PathProducer
@@ -189,37 +367,127 @@ struct PathProducer
         //Split the audio spectrum from 20Hz to 20KHz into 2048 or 4096 or 8192 frequency bins
         leftChannelFFTDataGenerator.changeOrder(FFTOrder::order2048);
         monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
+        monoBuffer.clear();
+
+        //Whatever is still in the fifo was captured before this analyser was listening
+        leftChannelFifo->discardAvailableBuffers();
+        samplesUntilPrimed = monoBuffer.getNumSamples();
     }
     void process(juce::Rectangle<float> fftBounds, double sameplRate);
+    void setSpectrogram(SpectrogramImage* s) { spectrogram = s; } //Also gets every FFT frame, nullptr when it isn't shown
+    void setRendering(AnalyserRendering newRendering) { rendering = newRendering; }
     juce::Path getPath() { return leftChannelFFTPath; }
+    const AnalyserSpans& getSpans() const { return spans; } //The newest frame, when rendering Spans
+    juce::int64 getPathCaptureTicks() const { return pathCaptureTicks; } //When the newest audio in getPath() was captured
+    void addTelemetry(AnalyserTelemetry& telemetry) const;
+    void addMemoryUsage(MemoryReport& report, const juce::String& name) const;
+    const AnalysisTables& getTables() const { return leftChannelFFTDataGenerator.getTables(); }
 private:
     SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* leftChannelFifo;
 
     juce::AudioBuffer<float> monoBuffer; //That are going to be send from the SCSF to the FFT Data Generator
-    FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
+    int samplesUntilPrimed = 0; //No FFT until monoBuffer holds a whole window of fresh audio, so the first frame isn't half silence
+    FFTDataGenerator<AnalyserFrame> leftChannelFFTDataGenerator;
 
+    AnalyserRendering rendering = AnalyserRendering::Spans;
     AnalyserPathGenerator<juce::Path> pathProducer; //Producing a path in our path generator
+    AnalyserSpans spans;
+    std::vector<float> fftBlock; //Pulled into, kept so the Spans mode doesn't allocate per frame
+    SpectrogramImage* spectrogram = nullptr;
 
     juce::Path leftChannelFFTPath;
+    juce::int64 newestCaptureTicks = 0, pathCaptureTicks = 0;
+    int queueDepth = 0, maxQueueDepth = 0;
+    juce::uint64 supersededPaths = 0;
+};
+
+/*
+The Pre and Diff views: the spectrum of the mid before the EQ, and post minus pre, from the processor's
+prePostFifo. Pre and post go through one complex FFT per frame, pre in the real parts and post in the
+imaginary parts, and SpectrumMath::pairToDecibels() separates them again, so the second signal costs a pass
+over the bins rather than a second FFT, and both use the same plan and window table. Created only while one
+of the views is on; like PathProducer it only transforms the newest window.
+*/
+struct PrePostAnalyser
+{
+    PrePostAnalyser(PrePostSampleFifo<SimpleEQAudioProcessor::BlockType>& fifo);
+    void process(juce::Rectangle<int> area, double sampleRate);
+    const AnalyserSpans& getPreSpans() const { return preSpans; }
+    const AnalyserSpans& getDifferenceSpans() const { return differenceSpans; } //On the response curve's +-24 dB scale
+    void addMemoryUsage(MemoryReport& report) const;
+    const AnalysisTables& getTables() const { return *tables; }
+
+private:
+    PrePostSampleFifo<SimpleEQAudioProcessor::BlockType>* prePostFifo;
+
+    juce::AudioBuffer<float> window; //Newest fftSize samples, pre in channel 0 and post in channel 1
+    int samplesUntilPrimed = 0;
+
+    const std::shared_ptr<const AnalysisTables> tables = AnalysisTables::get(FFTOrder::order2048); //Same as the PathProducers'
+    const int fftSize = tables->fftSize;
+    std::vector<std::complex<float>> timeData, frequencyData;
+    std::vector<float> preDecibels, postDecibels, difference;
+    bool hasDifference = false;
+
+    AnalyserSpans preSpans, differenceSpans;
+};
+
+/*
+One timer for every editor in the process. Instead of each editor running its own 60 Hz timer and FFTs,
+the editors register here and get serviced in turn within a fixed time budget per frame.
+The focused editor is serviced every frame, the other visible ones round robin with whatever budget is left,
+so the message thread cost stays bounded however many instances are open.
+*/
+struct AnalyserScheduler : juce::Timer
+{
+    struct Client
+    {
+        virtual ~Client() = default;
+        virtual void serviceAnalyser() = 0;     //pull the audio, run the FFT and repaint
+        virtual bool isAnalyserVisible() = 0;   //hidden or minimised clients are skipped
+        virtual bool hasAnalyserPriority() = 0; //serviced every frame, before the round robin
+    };
+
+    void addClient(Client* client);
+    void removeClient(Client* client);
+    void timerCallback() override;
+
+    void setFrameBudgetMs(double newBudgetMs) { frameBudgetMs = newBudgetMs; }
+    int getNumClients() const { return clients.size(); }
+
+private:
+    juce::Array<Client*> clients;
+    int nextClient = 0; //where the round robin carries on next frame
+    double frameBudgetMs = 6.0; //of the ~16.7 ms of a 60 Hz frame
 };
 
 struct ResponseCurveComponent: juce::Component,
                                juce::AudioProcessorParameter::Listener,
-                               juce::Timer
+                               AnalyserScheduler::Client
 {
     ResponseCurveComponent(SimpleEQAudioProcessor&);
     ~ResponseCurveComponent();
     void parameterValueChanged(int parameterIndex, float newValue) override;
-    void timerCallback() override;
+    void serviceAnalyser() override;
+    bool isAnalyserVisible() override;
+    bool hasAnalyserPriority() override;
     void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override {};
     void paint(juce::Graphics& g) override;
     void resized() override;
+    double getAnalyserCreationMs() const { return analyserCreationMs; } //-1 until the analyser has started
+    AnalyserTelemetry getAnalyserTelemetry() const;
+    void setSpectrogramVisible(bool shouldBeVisible);
+    void setAnalyserRendering(AnalyserRendering newRendering);
+    void setPreEQVisible(bool shouldBeVisible);      //The input spectrum, before the EQ
+    void setDifferenceVisible(bool shouldBeVisible); //Output minus input, per bin
+    void addMemoryUsage(MemoryReport& report) const;
 
 private:
     SimpleEQAudioProcessor& audioProcessor;
-    //In this timer callback we are going to query and atomic flag to decide if the chain needs updating and our component needs to be repainted
+    //When the scheduler services us we are going to query and atomic flag to decide if the chain needs updating and our component needs to be repainted
     juce::Atomic<bool> parametersChanged{ false };
     MonoChain monoChain;
+    BandEngine bands; //The processor's belongs to its audio thread, so the curve designs its own
 
     void updateChain();
 
@@ -228,14 +496,46 @@ private:
     juce::Rectangle<int> getRenderArea();
     juce::Rectangle<int> getAnalysisArea(); //Is going to be a little bit smaller than the RenderArea
 
-    PathProducer leftPathProducer, rightPathProducer;
+    //Created lazily on the first timer tick so they don't add to the editor open time
+    std::unique_ptr<PathProducer> leftPathProducer, rightPathProducer;
+    void createPathProducers();
+    double analyserCreationMs = -1.0;
+
+    AnalyserRendering analyserRendering = AnalyserRendering::Spans;
+    SpectrogramImage spectrogram; //Of the left channel, behind the curves while the Spec button is on
+    bool spectrogramVisible = false;
+
+    std::unique_ptr<PrePostAnalyser> prePostAnalyser; //Only while the Pre or Diff button is on
+    bool preEQVisible = false, differenceVisible = false;
+    void updatePrePostAnalyser();
+
+    //Audio to pixel latency, measured in paint() the first time each new path is drawn
+    juce::int64 lastPaintedCaptureTicks = 0;
+    double lastLatencyMs = 0.0, averageLatencyMs = 0.0, maxLatencyMs = 0.0;
+
+    juce::SharedResourcePointer<AnalyserScheduler> scheduler; //Shared by every editor in the process
 };
 
 
 //==============================================================================
 /**
 */
-class SimpleEQAudioProcessorEditor : public juce::AudioProcessorEditor
+//Optional overlay with the processBlock timing percentiles and the analyser telemetry, over the response curve
+struct TimingOverlay : juce::Component, juce::Timer
+{
+    TimingOverlay(SimpleEQAudioProcessor& p, const ResponseCurveComponent& curve);
+    void paint(juce::Graphics& g) override;
+    void timerCallback() override;
+    void visibilityChanged() override; //Only polls while it is shown
+
+private:
+    SimpleEQAudioProcessor& audioProcessor;
+    const ResponseCurveComponent& responseCurve;
+    juce::String timingText, analyserText;
+};
+
+class SimpleEQAudioProcessorEditor : public juce::AudioProcessorEditor,
+                                     private juce::ChangeListener
 {
 public:
     SimpleEQAudioProcessorEditor(SimpleEQAudioProcessor&);
@@ -243,27 +543,51 @@ public:
     //==============================================================================
     void paint(juce::Graphics&) override;
     void resized() override;
+
+    struct OpenTimings //Milliseconds, measured from the start of the constructor. -1 if it hasn't happened yet
+    {
+        double constructionMs = -1.0;
+        double firstPaintMs = -1.0;
+        double analyserCreationMs = -1.0; //Time spent creating the analyser resources on the first timer tick
+    };
+    OpenTimings getOpenTimings() const;
+    AnalyserTelemetry getAnalyserTelemetry() const { return responseCurveComponent.getAnalyserTelemetry(); }
+    void addMemoryUsage(MemoryReport& report) const; //See SimpleEQAudioProcessor::getMemoryReport()
         
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     SimpleEQAudioProcessor& audioProcessor;
 
+    const double openStartMs; //Initialised before the sliders so the whole construction is measured
+    OpenTimings openTimings;
+
     //In this timer callback we are going to query and atomic flag to decide if the chain needs updating and our component needs to be repainted
    // juce::Atomic<bool> parametersChanged{ false };
 
     RotarySliderWithLabels peakFreqSlider, peakGainSlider, peakQualitySlider, lowCutFreqSlider, highCutFreqSlider,
         lowCutSlopeSlider, highCutSlopeSlider;
+    //Dynamic mode of the Peak band, along the bottom
+    RotarySliderWithLabels peakThresholdSlider, peakRatioSlider, peakAttackSlider, peakReleaseSlider;
+    juce::TextButton peakDynamicButton{ "Dyn" }, peakSidechainButton{ "SC" };
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> peakDynamicAttachment, peakSidechainAttachment;
 
     ResponseCurveComponent responseCurveComponent;
+
+    //Preset bank and A/B/C/D slots along the top
+    juce::ComboBox presetBox;
+    juce::TextButton savePresetButton{ "Save" };
+    juce::TextButton timingButton{ "Stats" };
+    juce::TextButton spectrogramButton{ "Spec" };
+    juce::TextButton preEQButton{ "Pre" }, differenceButton{ "Diff" };
+    juce::TextButton autoGainButton{ "Auto" }; //The Auto Gain parameter
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> autoGainAttachment;
+    TimingOverlay timingOverlay;
+    std::array<juce::TextButton, SimpleEQAudioProcessor::NumSlots> slotButtons;
+    void refreshPresetBox(); //And the slot buttons
+    void changeListenerCallback(juce::ChangeBroadcaster*) override; //SimpleEQAudioProcessor::presetChanges
     
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> peakGainSliderAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> peakFreqSliderAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> peakQualitySliderAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> lowCutFreqSliderAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> highCutFreqSliderAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> lowCutSlopeSliderAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> highCutSlopeSliderAttachment;
+    std::vector<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>> sliderAttachments; //One per knob, to the parameter the knob was made for
 
     std::vector<juce::Component*> getComps(); //To have all the slider in a vector because I want to have done the same all the time to them (like makethemVisible)
 
@@ -6,21 +6,63 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 //==============================================================================
+//Every main parameter but the session only ones, at its default or at the value in 'changes'. Presets only set what
+//they list, so a factory preset sets the whole fixed EQ and leaves Bypass, Auto Gain and the extra bands as they are
+static juce::MemoryBlock makeFactoryPreset(const std::vector<std::pair<Parameters::ID, float>>& changes)
+{
+    std::vector<std::pair<juce::String, float>> values;
+    for (const auto& spec : Parameters::table)
+    {
+        if (Parameters::isSessionOnly(spec.id))
+            continue;
+
+        auto value = spec.defaultValue;
+        for (auto& change : changes)
+            if (change.first == spec.id)
+                value = change.second;
+        values.emplace_back(spec.name, value);
+    }
+    return StateFormat::makeState(values);
+}
+//Listed by the preset bank until it has a file, and written into it with the first preset the user saves
+static std::vector<std::pair<juce::String, juce::MemoryBlock>> getFactoryPresets()
+{
+    using namespace Parameters;
+    return
+    {
+        { "Default",        makeFactoryPreset({}) },
+        { "Rumble Filter",  makeFactoryPreset({ { LowCutFreq, 40.f }, { LowCutSlope, (float)Slope_36 } }) },
+        { "Presence Boost", makeFactoryPreset({ { PeakFreq, 3500.f }, { PeakGain, 4.f }, { PeakQuality, 0.8f } }) },
+        { "De-Mud",         makeFactoryPreset({ { LowCutFreq, 60.f }, { PeakFreq, 300.f }, { PeakGain, -4.f }, { PeakQuality, 1.2f } }) },
+        { "Telephone",      makeFactoryPreset({ { LowCutFreq, 300.f }, { LowCutSlope, (float)Slope_48 },
+                                                { HighCutFreq, 3400.f }, { HighCutSlope, (float)Slope_48 } }) },
+    };
+}
+//==============================================================================
 SimpleEQAudioProcessor::SimpleEQAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
         : AudioProcessor(BusesProperties()                    //In this constructor is initialised any object before go to the body of the constructor
 #if ! JucePlugin_IsMidiEffect
 #if ! JucePlugin_IsSynth
             .withInput("Input", juce::AudioChannelSet::stereo(), true)
+            .withInput("Sidechain", juce::AudioChannelSet::stereo(), false) //Optional detector input for the dynamic Peak band
 #endif
             .withOutput("Output", juce::AudioChannelSet::stereo(), true)
 #endif
         )
 #endif
 {
+    presetBank->setFactoryPresets(getFactoryPresets()); //Memory only, no disk access from the constructor
+
+   #if SIMPLEEQ_RT_CHECKS
+    startTimerHz(30);
+   #endif
 }
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
 {
+   #if SIMPLEEQ_RT_CHECKS
+    stopTimer();
+   #endif
 }
 //==============================================================================
 const juce::String SimpleEQAudioProcessor::getName() const
@@ -53,23 +95,31 @@ bool SimpleEQAudioProcessor::isMidiEffect() const
 }
 double SimpleEQAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load(); //Worked out from the poles of the filters in updateTailLength(), capped there
 }
 int SimpleEQAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return juce::jmax(1, presetBank->getNumPresets());   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                                                         // so this should be at least 1, even if you're not really implementing programs.
 }
 int SimpleEQAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 void SimpleEQAudioProcessor::setCurrentProgram(int index)
 {
+    const void* data = nullptr;
+    int size = 0;
+    if (presetBank->getPresetData(index, data, size))
+    {
+        applyState(data, size, StateFormat::Scope::Snapshot);
+        currentProgram = index;
+        presetChanges.sendChangeMessage(); //Usually the host, the editor's preset box has to follow
+    }
 }
 const juce::String SimpleEQAudioProcessor::getProgramName(int index)
 {
-    return {};
+    return presetBank->getNumPresets() > 0 ? presetBank->getName(index) : juce::String("Default");
 }
 void SimpleEQAudioProcessor::changeProgramName(int index, const juce::String& newName)
 {
@@ -80,13 +130,17 @@ void SimpleEQAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
     //Prepare the FIlters before we use them
+    preparedBlockSize = juce::jmax(samplesPerBlock, minPreparedBlockSize);
+
     juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
+    spec.maximumBlockSize = (juce::uint32)preparedBlockSize;
     spec.numChannels = 1;
     spec.sampleRate = sampleRate;
     //Pass those spec especifications to the Filters:
     leftChain.prepare(spec);
     rightChain.prepare(spec);
+    makeSecondOrder(leftChain);
+    makeSecondOrder(rightChain);
 
     //
     //       auto chainSettings = getChainSettings(apvts); //Settings from the apvts
@@ -110,10 +164,42 @@ void SimpleEQAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
     //     
     //        updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
     //        updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+    dynamicPeak.prepare(sampleRate);
+    warmCoefficientCache(sampleRate);
+    currentSettings = getChainSettings(parameters);
+    stateSwitchesSeen = stateSwitches.load();
     updateFilters();
 
-    leftChannelFifo.prepare(samplesPerBlock);
-    rightChannelFifo.prepare(samplesPerBlock);
+    bandEngine.prepare(sampleRate);
+    updateBands();
+
+    const auto analyserQueueDepth = getAnalyserQueueDepth(sampleRate);
+    leftChannelFifo.prepare(analyserBufferSize, analyserQueueDepth);
+    rightChannelFifo.prepare(analyserBufferSize, analyserQueueDepth);
+    prePostFifo.prepare(analyserBufferSize, preparedBlockSize, analyserQueueDepth);
+
+    tailNeedsUpdate = true;
+    silentSamples = 0;
+    processingIsIdle = false;
+
+    autoGainResponse.prepare(sampleRate); //A new sample rate moves the cuts relative to the weighting
+    autoGainNeedsUpdate = true;
+    updateAutoGain(currentSettings);
+    autoGain.reset(sampleRate, autoGainRampSeconds);
+    autoGain.setCurrentAndTargetValue(parameters.get<Parameters::AutoGain>() ? autoGainTarget : 1.f);
+
+    bypassMix.reset(sampleRate, bypassFadeSeconds);
+    bypassMix.setCurrentAndTargetValue(parameters.get<Parameters::Bypass>() ? 1.f : 0.f);
+    dryBuffer.setSize(getMainBusNumOutputChannels(), preparedBlockSize);
+    fadeRamp.resize((size_t)preparedBlockSize);
+
+    outgoingLeftChain.prepare(spec);
+    outgoingRightChain.prepare(spec);
+    makeSecondOrder(outgoingLeftChain);
+    makeSecondOrder(outgoingRightChain);
+    outgoingBuffer.setSize(getMainBusNumOutputChannels(), preparedBlockSize);
+    switchMix.reset(sampleRate, switchFadeSeconds);
+    switchMix.setCurrentAndTargetValue(1.f);
 
     //The oscillator wants a funcion that return a value when you feed it a radian angle
     osc.initialise([](float x) {return std::sin(x); });
@@ -144,6 +230,15 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts)
 #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+    // The sidechain can be left disconnected, or be mono or stereo.
+    if (layouts.inputBuses.size() > 1)
+    {
+        auto sidechain = layouts.getChannelSet(true, 1);
+        if (!sidechain.isDisabled()
+            && sidechain != juce::AudioChannelSet::mono()
+            && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
 #endif
     return true;
 #endif
@@ -151,6 +246,8 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts)
 #endif
 void SimpleEQAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) //This is called by the Host
 {
+    BlockTimingHistogram::ScopedTimer blockTimer(blockTiming, buffer.getNumSamples(), getSampleRate());
+    RealtimeCheck::ScopedAudioThread realtimeCheck; //Allocations and locks from here on are reported, with SIMPLEEQ_RT_CHECKS
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -163,7 +260,67 @@ void SimpleEQAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    updateFilters();
+    const auto numSamples = buffer.getNumSamples();
+    if (numSamples <= preparedBlockSize)
+    {
+        processPreparedBlock(buffer);
+        return;
+    }
+
+    //Bigger than announced: run it in pieces. The pieces point into the host's buffer, nothing is copied or allocated
+    for (int start = 0; start < numSamples; start += preparedBlockSize)
+    {
+        juce::AudioBuffer<float> piece(buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                       start, juce::jmin(preparedBlockSize, numSamples - start));
+        processPreparedBlock(piece);
+    }
+}
+void SimpleEQAudioProcessor::processPreparedBlock(juce::AudioBuffer<float>& buffer)
+{
+    const auto totalNumInputChannels = getTotalNumInputChannels();
+    const auto numSamples = buffer.getNumSamples();
+    jassert(numSamples <= dryBuffer.getNumSamples() && numSamples <= outgoingBuffer.getNumSamples());
+
+    const bool bypassed = hostBypassed || parameters.get<Parameters::Bypass>();
+    if (bypassed != (bypassMix.getTargetValue() > 0.5f))
+    {
+        if (!bypassed && !bypassMix.isSmoothing()) //The filters still hold what they had when the bypass was engaged
+            resetProcessing();
+        bypassMix.setTargetValue(bypassed ? 1.f : 0.f);
+    }
+
+    if (bypassed && !bypassMix.isSmoothing()) //Fully bypassed: the buffer already is the output
+    {
+        numActiveBiquads.store(0, std::memory_order_relaxed);
+        beginAnalyserCapture();
+        if (preEQWasCapturing)
+            prePostFifo.capturePre(buffer); //The same as the output
+        captureForAnalyser(buffer);
+        return;
+    }
+
+    if (skipSilentBlock(buffer)) //The input is silent and the filters have rung out: the output is the input
+    {
+        bypassMix.skip(numSamples);
+        switchMix.skip(numSamples);
+        numActiveBiquads.store(0, std::memory_order_relaxed);
+        analyserWasCapturing = false; //So the analyser starts from a fresh buffer when the sound comes back
+        return;
+    }
+
+    beginAnalyserCapture();
+    if (preEQWasCapturing)
+        prePostFifo.capturePre(buffer);
+
+    const bool crossfading = bypassMix.isSmoothing();
+    if (crossfading)
+        for (int channel = 0; channel < dryBuffer.getNumChannels(); ++channel)
+            dryBuffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+    auto chainSettings = updateFilters();
+    updateBands();
+    updateTailLength(chainSettings);
+    updateAutoGain(chainSettings);
     //Produce Coefficients using the static helper function from the IIR coeficients class
                                                     //      auto chainSettings = getChainSettings(apvts);
                                                     //      updatePeakFilter(chainSettings); //Refactoring the coefficients
@@ -293,18 +450,55 @@ void SimpleEQAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce
   //  juce::dsp::ProcessContextReplacing<float> stereoContext(block); //Osc testing
   //  osc.process(stereoContext);
 
-    //Extract individual channel from the buffer:
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
-    //Create Processing Context that wrap each individual AudioBlock:
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
-    //Pass this context to the monoFilters:
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    block = block.getSubsetChannelBlock(0, (size_t)getMainBusNumOutputChannels()); //Leave the sidechain channels out
 
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+    const bool switchFading = switchMix.isSmoothing();
+    if (switchFading)
+        for (int channel = 0; channel < outgoingBuffer.getNumChannels(); ++channel)
+            outgoingBuffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+    if (chainSettings.peakDynamic)
+    {
+        //The detector listens to the sidechain when asked to and connected, otherwise to the input before it is filtered
+        const bool useSidechain = chainSettings.peakUseSidechain
+                                  && getBusCount(true) > 1 && getBus(true, 1)->isEnabled();
+        processChainsWithDynamicPeak(block, getBusBuffer(buffer, true, useSidechain ? 1 : 0));
+    }
+    else
+    {
+        //Extract individual channel from the buffer:
+        auto leftBlock = block.getSingleChannelBlock(0);
+        auto rightBlock = block.getSingleChannelBlock(1);
+        //Create Processing Context that wrap each individual AudioBlock:
+        juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+        juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+        //Pass this context to the monoFilters:
+        leftChain.process(leftContext);
+        rightChain.process(rightContext);
+    }
+
+    if (switchFading)
+        mixOutgoingChains(block);
+
+    bandEngine.process(block); //Only the enabled extra bands
+    applyAutoGain(buffer);
+    numActiveBiquads.store(chainBiquads + bandEngine.getNumActiveBands(), std::memory_order_relaxed);
+
+    if (crossfading)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            fadeRamp[(size_t)i] = bypassMix.getNextValue();
+
+        for (int channel = 0; channel < dryBuffer.getNumChannels(); ++channel)
+        {
+            auto* out = buffer.getWritePointer(channel);
+            const auto* dry = dryBuffer.getReadPointer(channel);
+            for (int i = 0; i < numSamples; ++i)
+                out[i] += (dry[i] - out[i]) * fadeRamp[(size_t)i];
+        }
+    }
+
+    captureForAnalyser(buffer);
 
 
     // This is the place where you'd normally do the guts of your plugin's
@@ -319,6 +513,42 @@ void SimpleEQAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce
         // ..do something to the data...
     }
 }
+void SimpleEQAudioProcessor::processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    //For hosts that bypass without going through the parameter, so they get the same crossfade
+    const juce::ScopedValueSetter<bool> bypassing(hostBypassed, true);
+    processBlock(buffer, midiMessages);
+}
+juce::AudioProcessorParameter* SimpleEQAudioProcessor::getBypassParameter() const
+{
+    return apvts.getParameter(Parameters::getID(Parameters::Bypass));
+}
+void SimpleEQAudioProcessor::beginAnalyserCapture()
+{
+    const bool analyserIsListening = analyserConsumers.load(std::memory_order_relaxed) > 0;
+    const bool preEQIsListening = analyserIsListening && preEQConsumers.load(std::memory_order_relaxed) > 0;
+
+    //Start from empty buffers after being idle, and all together when the pre EQ tap comes in, so the
+    //buffers of every fifo keep covering the same samples
+    if (analyserIsListening && (!analyserWasCapturing || (preEQIsListening && !preEQWasCapturing)))
+    {
+        leftChannelFifo.restart();
+        rightChannelFifo.restart();
+        prePostFifo.restart();
+    }
+    analyserWasCapturing = analyserIsListening;
+    preEQWasCapturing = preEQIsListening;
+}
+void SimpleEQAudioProcessor::captureForAnalyser(const juce::AudioBuffer<float>& buffer)
+{
+    if (analyserWasCapturing)
+    {
+        leftChannelFifo.update(buffer);
+        rightChannelFifo.update(buffer);
+    }
+    if (preEQWasCapturing)
+        prePostFifo.capturePost(buffer);
+}
 //==============================================================================
 bool SimpleEQAudioProcessor::hasEditor() const
 {
@@ -330,35 +560,215 @@ juce::AudioProcessorEditor* SimpleEQAudioProcessor::createEditor()
     //  return new GenericAudioProcessorEditor(*this);
 }
 //==============================================================================
+void SimpleEQAudioProcessor::mixOutgoingChains(juce::dsp::AudioBlock<float>& block)
+{
+    const auto numSamples = (int)block.getNumSamples();
+
+    juce::dsp::AudioBlock<float> outgoing(outgoingBuffer.getArrayOfWritePointers(), (size_t)outgoingBuffer.getNumChannels(), (size_t)numSamples);
+    auto leftBlock = outgoing.getSingleChannelBlock(0);
+    auto rightBlock = outgoing.getSingleChannelBlock(1);
+    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    outgoingLeftChain.process(leftContext);
+    outgoingRightChain.process(rightContext);
+
+    for (int i = 0; i < numSamples; ++i)
+        fadeRamp[(size_t)i] = switchMix.getNextValue();
+
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+    {
+        auto* out = block.getChannelPointer(channel);
+        const auto* old = outgoingBuffer.getReadPointer((int)channel);
+        for (int i = 0; i < numSamples; ++i)
+            out[i] = old[i] + (out[i] - old[i]) * fadeRamp[(size_t)i];
+    }
+}
+//==============================================================================
 void SimpleEQAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);  //To save the parameters of the GUI in a memory
+    stateFormat.write(destData, StateFormat::Scope::Session); //Compact binary, see StateFormat.h. Older sessions were the whole apvts.state ValueTree
+    StateFormat::appendSlots(destData, currentProgram, currentSlot, slots.data(), NumSlots);
 }
 void SimpleEQAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes); //Read that memory with the data of the parameters saved
-    if (tree.isValid()) //Check if the tree that was pulled from memory is valid before we copy it to out plugins state
+    applyState(data, sizeInBytes, StateFormat::Scope::Session);
+
+    //The slots come back with the session. One saved without them starts with empty slots, as a new instance would
+    for (auto& slot : slots)
+        slot.reset();
+    int program = 0, slot = 0;
+    StateFormat::readSlots(data, sizeInBytes, program, slot, slots.data(), NumSlots);
+    currentProgram = juce::jlimit(0, getNumPrograms() - 1, program);
+    currentSlot = juce::jlimit(0, NumSlots - 1, slot);
+    presetChanges.sendChangeMessage();
+}
+void SimpleEQAudioProcessor::applyState(const void* data, int sizeInBytes, StateFormat::Scope scope)
+{
+    //Nothing here touches the filters: the audio thread picks the new values up in its next updateFilters()
+    stateLoadSequence.fetch_add(1, std::memory_order_acq_rel);
+
+    bool loaded = false;
+    if (StateFormat::isCompactState(data, sizeInBytes))
+    {
+        loaded = stateFormat.read(data, sizeInBytes, scope);
+    }
+    else
     {
-        apvts.replaceState(tree);
-        updateFilters();
+        auto tree = juce::ValueTree::readFromData(data, sizeInBytes); //Read that memory with the data of the parameters saved
+        if (tree.isValid()) //Check if the tree that was pulled from memory is valid before we copy it to out plugins state
+        {
+            apvts.replaceState(tree);
+            loaded = true;
+        }
     }
+
+    if (loaded && getSampleRate() > 0.0)
+        warmCoefficientCache(getSampleRate());
+
+    if (loaded && scope == StateFormat::Scope::Snapshot)
+        stateSwitches.fetch_add(1, std::memory_order_relaxed);
+
+    stateLoadSequence.fetch_add(1, std::memory_order_release);
+}
+void SimpleEQAudioProcessor::selectSlot(int slot)
+{
+    jassert(juce::isPositiveAndBelow(slot, NumSlots));
+    if (slot == currentSlot)
+        return;
+
+    stateFormat.write(slots[(size_t)currentSlot], StateFormat::Scope::Snapshot); //The edits made since the last switch belong to the slot being left
+    currentSlot = slot;
+
+    auto& state = slots[(size_t)slot];
+    if (state.getSize() == 0)
+        stateFormat.write(state, StateFormat::Scope::Snapshot); //First visit: same settings as where we came from, nothing to switch
+    else
+        applyState(state.getData(), (int)state.getSize(), StateFormat::Scope::Snapshot);
 }
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts) //Get the parameters values from the APVTS
+int SimpleEQAudioProcessor::savePreset(const juce::String& name)
 {
+    juce::MemoryBlock state;
+    stateFormat.write(state, StateFormat::Scope::Snapshot);
+    currentProgram = presetBank->addPreset(name, state);
+    updateHostDisplay(); //The program list changed
+    presetChanges.sendChangeMessage();
+    return currentProgram;
+}
+bool SimpleEQAudioProcessor::skipSilentBlock(const juce::AudioBuffer<float>& buffer)
+{
+    const auto numSamples = buffer.getNumSamples();
+
+    bool inputIsSilent = true;
+    for (int channel = 0; channel < getMainBusNumInputChannels(); ++channel)
+    {
+        if (buffer.getMagnitude(channel, 0, numSamples) > silenceThreshold)
+        {
+            inputIsSilent = false;
+            break;
+        }
+    }
+
+    if (!inputIsSilent)
+    {
+        if (processingIsIdle) //What is left in the filters is below the threshold, start them from exact zero
+            resetProcessing();
+
+        processingIsIdle = false;
+        silentSamples = 0;
+        return false;
+    }
+
+    //Only skip once the tail had already decayed at the start of this block
+    processingIsIdle = (double)silentSamples >= tailLengthInSamples;
+    silentSamples += numSamples;
+    return processingIsIdle;
+}
+void SimpleEQAudioProcessor::resetProcessing()
+{
+    leftChain.reset();
+    rightChain.reset();
+    bandEngine.reset();
+    dynamicPeak.reset();
+    switchMix.setCurrentAndTargetValue(1.f); //Whatever the outgoing chains held is stale too
+}
+template<typename CutChainType>
+static double getCutTailSamples(const CutChainType& cut)
+{
+    double samples = 0.0;
+    if (!cut.template isBypassed<0>()) samples += getDecayLengthInSamples(*cut.template get<0>().coefficients);
+    if (!cut.template isBypassed<1>()) samples += getDecayLengthInSamples(*cut.template get<1>().coefficients);
+    if (!cut.template isBypassed<2>()) samples += getDecayLengthInSamples(*cut.template get<2>().coefficients);
+    if (!cut.template isBypassed<3>()) samples += getDecayLengthInSamples(*cut.template get<3>().coefficients);
+    return samples;
+}
+void SimpleEQAudioProcessor::updateTailLength(const ChainSettings& chainSettings)
+{
+    if (tailNeedsUpdate || chainSettings != tailSettings) //The poles only move when the settings do
+    {
+        tailSettings = chainSettings;
+        tailNeedsUpdate = false;
+
+        //The sections are in series, so their decay times add up. That overestimates a little, which only delays the skipping
+        chainTailSamples = getCutTailSamples(leftChain.get<ChainPositions::LowCut>())
+                         + getCutTailSamples(leftChain.get<ChainPositions::HighCut>());
+
+        if (chainSettings.peakDynamic) //The gain moves every sub-block, take the deepest cut it can reach
+        {
+            float deepest[CoefficientDesign::NumCoefficients];
+            CoefficientDesign::makePeak(deepest, getSampleRate(), chainSettings.peakFreq, chainSettings.peakQuality, -48.f);
+            chainTailSamples += getDecayLengthInSamples(deepest, CoefficientDesign::NumCoefficients);
+        }
+        else if (!leftChain.isBypassed<ChainPositions::Peak>())
+            chainTailSamples += getDecayLengthInSamples(*leftChain.get<ChainPositions::Peak>().coefficients);
+    }
+
+    tailLengthInSamples = chainTailSamples + bandEngine.getTailLengthInSamples();
+    tailLengthSeconds.store(juce::jmin(tailLengthInSamples / getSampleRate(), maxReportedTailSeconds), std::memory_order_relaxed);
+}
+void SimpleEQAudioProcessor::processChainsWithDynamicPeak(juce::dsp::AudioBlock<float>& block, const juce::AudioBuffer<float>& detector)
+{
+    const auto numSamples = (int)block.getNumSamples();
+
+    for (int start = 0; start < numSamples; start += DynamicPeak::SubBlockSize)
+    {
+        const auto num = jmin(DynamicPeak::SubBlockSize, numSamples - start);
+
+        //The detector has to read this sub-block before the chains filter it in place
+        auto gainInDecibels = dynamicPeak.processDetector(detector, start, num);
+        dynamicPeak.updatePeakGain(leftChain.get<ChainPositions::Peak>().coefficients, gainInDecibels);
+        dynamicPeak.updatePeakGain(rightChain.get<ChainPositions::Peak>().coefficients, gainInDecibels);
+
+        auto subBlock = block.getSubBlock((size_t)start, (size_t)num);
+        auto leftBlock = subBlock.getSingleChannelBlock(0);
+        auto rightBlock = subBlock.getSingleChannelBlock(1);
+        juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+        juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+        leftChain.process(leftContext);
+        rightChain.process(rightContext);
+    }
+}
+ChainSettings getChainSettings(const Parameters::Handles& parameters) //Real world values in the ranges of the table, not normalised ones
+{
+    using namespace Parameters;
     ChainSettings settings;
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load(); //getParameters gives normalized values. But this function gives real world parameters, that are in the Range we said. They are atomic
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
-    settings.lowCutSlope = (Slope)apvts.getRawParameterValue("LowCut Slope")->load();
-    settings.highCutSlope = (Slope)apvts.getRawParameterValue("HighCut Slope")->load();
+    settings.lowCutFreq = parameters.get<LowCutFreq>();
+    settings.highCutFreq = parameters.get<HighCutFreq>();
+    settings.peakFreq = parameters.get<PeakFreq>();
+    settings.peakGainInDecibels = parameters.get<PeakGain>();
+    settings.peakQuality = parameters.get<PeakQuality>();
+    settings.lowCutSlope = (Slope)parameters.get<LowCutSlope>();
+    settings.highCutSlope = (Slope)parameters.get<HighCutSlope>();
+    settings.peakDynamic = parameters.get<PeakDynamic>();
+    settings.peakUseSidechain = parameters.get<PeakSidechain>();
+    settings.peakThresholdInDecibels = parameters.get<PeakThreshold>();
+    settings.peakRatio = parameters.get<PeakRatio>();
+    settings.peakAttackMs = parameters.get<PeakAttack>();
+    settings.peakReleaseMs = parameters.get<PeakRelease>();
     return settings;
 }
 
@@ -378,64 +788,345 @@ void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings
    //     juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
     // *leftChain.get<ChainPositions::Peak>().coefficients = *peakCoefficients; //Access links in the processor chain. selecting an index in the chain inside the <>
     // *rightChain.get<ChainPositions::Peak>().coefficients = *peakCoefficients;
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    auto& left = leftChain.get<ChainPositions::Peak>().coefficients;
+    auto& right = rightChain.get<ChainPositions::Peak>().coefficients;
+
+    //Audio thread: only look the design up, designing into the cache would allocate
+    if (auto* cached = coefficientCache->findPeak(chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDecibels, getSampleRate()))
+    {
+        updateCoefficients(left, cached->getUnchecked(0));
+    }
+    else
+    {
+        jassert(left->coefficients.size() == CoefficientDesign::NumCoefficients);
+        CoefficientDesign::makePeak(left->coefficients.getRawDataPointer(), getSampleRate(),
+                                    chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDecibels);
+    }
+    updateCoefficients(right, left);
 }
 void /*SimpleEQAudioProcessor::*/updateCoefficients(Coefficients& old, const Coefficients& replacements)
 {
-    *old = *replacements;
+    //Copying the values in place keeps this free of allocations, assigning the whole object reallocates its array
+    if (old->coefficients.size() == replacements->coefficients.size())
+        std::copy(replacements->coefficients.begin(), replacements->coefficients.end(), old->coefficients.begin());
+    else
+        *old = *replacements;
 }
 //Commented on Pre Play and Process Block:
 void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings& chainSettings)
 {
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
     auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
     auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
 
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope); //Refactoring the Slope coefficients
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope); //As I have a functio for do this in the left Channel and can use the same function for the rigt channel. Just change the work rightLowcut
+    if (auto* lowCutCoefficients = coefficientCache->findLowCut(chainSettings.lowCutFreq, 2 * (chainSettings.lowCutSlope + 1), getSampleRate()))
+    {
+        updateCutFilter(leftLowCut, *lowCutCoefficients, chainSettings.lowCutSlope); //Refactoring the Slope coefficients
+        updateCutFilter(rightLowCut, *lowCutCoefficients, chainSettings.lowCutSlope); //As I have a functio for do this in the left Channel and can use the same function for the rigt channel. Just change the work rightLowcut
+    }
+    else //Not in the cache yet (automation to a new value): same sections, designed in place. The cache has queued it
+    {
+        designCutFilter(leftLowCut, true, chainSettings.lowCutFreq, chainSettings.lowCutSlope, getSampleRate());
+        copyCutFilter(leftLowCut, rightLowCut);
+    }
 }
 void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings& chainSettings)
 {
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
-                                                
     auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
     auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+
+    if (auto* highCutCoefficients = coefficientCache->findHighCut(chainSettings.highCutFreq, 2 * (chainSettings.highCutSlope + 1), getSampleRate()))
+    {
+        updateCutFilter(leftHighCut, *highCutCoefficients, chainSettings.highCutSlope);
+        updateCutFilter(rightHighCut, *highCutCoefficients, chainSettings.highCutSlope);
+    }
+    else
+    {
+        designCutFilter(leftHighCut, false, chainSettings.highCutFreq, chainSettings.highCutSlope, getSampleRate());
+        copyCutFilter(leftHighCut, rightHighCut);
+    }
 }
-void SimpleEQAudioProcessor::updateFilters()
+void SimpleEQAudioProcessor::makeSecondOrder(MonoChain& chain)
 {
-    auto chainSettings = getChainSettings(apvts);
+    //A Filter starts with first order pass through coefficients, and a stage that never ran keeps them.
+    //The reset sizes the state for the new order here: left to the first process() it would allocate on the audio thread
+    auto setUp = [](Filter& filter)
+    {
+        if (filter.coefficients->coefficients.size() != CoefficientDesign::NumCoefficients)
+            *filter.coefficients = juce::dsp::IIR::Coefficients<float>(1.f, 0.f, 0.f, 1.f, 0.f, 0.f);
+        filter.reset();
+    };
+
+    auto& lowCut = chain.get<ChainPositions::LowCut>();
+    auto& highCut = chain.get<ChainPositions::HighCut>();
+    for (auto* filter : { &lowCut.get<0>(), &lowCut.get<1>(), &lowCut.get<2>(), &lowCut.get<3>(),
+                          &chain.get<ChainPositions::Peak>(),
+                          &highCut.get<0>(), &highCut.get<1>(), &highCut.get<2>(), &highCut.get<3>() })
+        setUp(*filter);
+}
+void SimpleEQAudioProcessor::warmCoefficientCache(double sampleRate)
+{
+    //Design every slope of the current cut frequencies and the current peak up front, so the first blocks
+    //and a slope change only hit the cache
+    auto chainSettings = getChainSettings(parameters);
+    CutCoefficients scratch;
+
+    for (auto slope : { Slope_12, Slope_24, Slope_36, Slope_48 })
+    {
+        chainSettings.lowCutSlope = chainSettings.highCutSlope = slope;
+        makeLowCutFilter(chainSettings, sampleRate, *coefficientCache, scratch);
+        makeHighCutFilter(chainSettings, sampleRate, *coefficientCache, scratch);
+    }
+
+    makePeakFilter(chainSettings, sampleRate, *coefficientCache);
+}
+template<int Position>
+void SimpleEQAudioProcessor::setChainPositionActive(bool shouldBeActive)
+{
+    if (shouldBeActive && leftChain.isBypassed<Position>()) //Coming back: don't resume from the state it had when it was taken out
+    {
+        leftChain.get<Position>().reset();
+        rightChain.get<Position>().reset();
+    }
+
+    leftChain.setBypassed<Position>(!shouldBeActive);
+    rightChain.setBypassed<Position>(!shouldBeActive);
+}
+ChainSettings SimpleEQAudioProcessor::updateFilters()
+{
+    const auto sequence = stateLoadSequence.load(std::memory_order_acquire);
+    if ((sequence & 1) == 0)
+    {
+        auto settings = getChainSettings(parameters);
+        auto switches = stateSwitches.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        //A switch that comes while the last one is still fading waits for it to finish (switchFadeSeconds at most):
+        //swapping now would put the still fading chains back live and cut the older sound off with a click.
+        //Quick A/B toggling then fades once to wherever the toggling ended
+        const bool switchWaits = switches != stateSwitchesSeen && switchMix.isSmoothing();
+
+        if (stateLoadSequence.load(std::memory_order_relaxed) == sequence && !switchWaits)
+        {
+            currentSettings = settings;
+
+            if (switches != stateSwitchesSeen) //A slot or preset switch: the old filters go on ringing in the outgoing chains
+            {
+                stateSwitchesSeen = switches;
+                std::swap(leftChain, outgoingLeftChain); //Moves only, no allocation
+                std::swap(rightChain, outgoingRightChain);
+                leftChain.reset();
+                rightChain.reset();
+                tailNeedsUpdate = true;
+                switchMix.setCurrentAndTargetValue(0.f);
+                switchMix.setTargetValue(1.f);
+            }
+        }
+    }
+
+    const auto chainSettings = currentSettings;
+    dynamicPeak.setParameters(chainSettings);
+
+    //Only design what is going to run. The cuts always do
+    const bool peakActive = isPeakActive(chainSettings);
+
     updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
+    if (peakActive && !chainSettings.peakDynamic) //In dynamic mode the peak coefficients are written per sub-block by processChainsWithDynamicPeak
+        updatePeakFilter(chainSettings);
     updateHighCutFilters(chainSettings);
+
+    setChainPositionActive<ChainPositions::Peak>(peakActive);
+
+    chainBiquads = chainSettings.lowCutSlope + 1
+                 + (peakActive ? 1 : 0)
+                 + chainSettings.highCutSlope + 1;
+    return chainSettings;
+}
+//==============================================================================
+void DynamicPeak::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    freq = quality = attackMs = releaseMs = -1.f; //Force everything to be recomputed for the new rate
+    reset();
+}
+void DynamicPeak::reset()
+{
+    z1 = z2 = envelope = 0.f;
+}
+void DynamicPeak::setParameters(const ChainSettings& chainSettings)
+{
+    if (chainSettings.peakFreq != freq || chainSettings.peakQuality != quality)
+    {
+        //Same omega and alpha as IIR::Coefficients::makePeakFilter
+        freq = chainSettings.peakFreq;
+        quality = chainSettings.peakQuality;
+        auto omega = MathConstants<float>::twoPi * jmax(freq, 2.f) / (float)sampleRate;
+        cosOmega = std::cos(omega);
+        alpha = std::sin(omega) / (quality * 2.f);
+
+        //RBJ band pass with 0 dB peak gain at the same frequency and Q
+        auto a0inv = 1.f / (1.f + alpha);
+        bp0 = alpha * a0inv;
+        bp2 = -alpha * a0inv;
+        bpA1 = -2.f * cosOmega * a0inv;
+        bpA2 = (1.f - alpha) * a0inv;
+    }
+
+    if (chainSettings.peakAttackMs != attackMs)
+    {
+        attackMs = chainSettings.peakAttackMs;
+        attackCoeff = std::exp(-1.f / (attackMs * 0.001f * (float)sampleRate));
+    }
+
+    if (chainSettings.peakReleaseMs != releaseMs)
+    {
+        releaseMs = chainSettings.peakReleaseMs;
+        releaseCoeff = std::exp(-1.f / (releaseMs * 0.001f * (float)sampleRate));
+    }
+
+    thresholdInDecibels = chainSettings.peakThresholdInDecibels;
+    slope = 1.f - 1.f / jmax(1.f, chainSettings.peakRatio);
+    staticGainInDecibels = chainSettings.peakGainInDecibels;
+}
+float DynamicPeak::processDetector(const juce::AudioBuffer<float>& detector, int startSample, int numSamples)
+{
+    const auto numChannels = jmin(detector.getNumChannels(), 2);
+    if (numChannels == 0)
+        return staticGainInDecibels;
+
+    const auto* left = detector.getReadPointer(0, startSample);
+    const auto* right = detector.getReadPointer(numChannels - 1, startSample);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto x = 0.5f * (left[i] + right[i]);
+
+        const auto y = bp0 * x + z1;
+        z1 = z2 - bpA1 * y;
+        z2 = bp2 * x - bpA2 * y;
+
+        const auto level = std::abs(y);
+        const auto coeff = level > envelope ? attackCoeff : releaseCoeff;
+        envelope = level + coeff * (envelope - level);
+    }
+
+    //One log per sub-block, the envelope itself is followed in the linear domain
+    auto overInDecibels = Decibels::gainToDecibels(envelope, -100.f) - thresholdInDecibels;
+    auto gainReduction = jmax(0.f, overInDecibels) * slope;
+    return jlimit(-48.f, 24.f, staticGainInDecibels - gainReduction);
+}
+void DynamicPeak::updatePeakGain(Coefficients& coefficients, float gainInDecibels) const
+{
+    jassert(coefficients->coefficients.size() == 5);
+
+    //makePeakFilter with the cached omega and alpha: only A depends on the gain
+    const auto A = std::exp(gainInDecibels * 0.05756463f); //10^(gain / 40), the constant is ln(10) / 40
+    const auto alphaTimesA = alpha * A;
+    const auto alphaOverA = alpha / A;
+    const auto c2 = -2.f * cosOmega;
+    const auto a0inv = 1.f / (1.f + alphaOverA);
+
+    auto* c = coefficients->coefficients.getRawDataPointer();
+    c[0] = (1.f + alphaTimesA) * a0inv;
+    c[1] = c2 * a0inv;
+    c[2] = (1.f - alphaTimesA) * a0inv;
+    c[3] = c2 * a0inv;
+    c[4] = (1.f - alphaOverA) * a0inv;
+}
+#if SIMPLEEQ_RT_CHECKS
+void SimpleEQAudioProcessor::timerCallback()
+{
+    if (RealtimeCheck::getNumViolations() > reportedViolations)
+    {
+        reportedViolations = RealtimeCheck::getNumViolations();
+        DBG(RealtimeCheck::getReport());
+        jassertfalse; //processBlock allocated or locked, the stack traces are above
+    }
+}
+#endif
+template<typename CutChainType>
+static void addCutResponse(AutoGain::Response& response, const CutChainType& cut)
+{
+    if (!cut.template isBypassed<0>()) response.addSection(cut.template get<0>().coefficients->coefficients.getRawDataPointer());
+    if (!cut.template isBypassed<1>()) response.addSection(cut.template get<1>().coefficients->coefficients.getRawDataPointer());
+    if (!cut.template isBypassed<2>()) response.addSection(cut.template get<2>().coefficients->coefficients.getRawDataPointer());
+    if (!cut.template isBypassed<3>()) response.addSection(cut.template get<3>().coefficients->coefficients.getRawDataPointer());
+}
+void SimpleEQAudioProcessor::updateAutoGain(const ChainSettings& chainSettings)
+{
+    if (!autoGainNeedsUpdate && chainSettings == autoGainSettings) //The coefficients only change when the settings do
+        return;
+
+    autoGainNeedsUpdate = false;
+    autoGainSettings = chainSettings;
+
+    //The sections the chains and the band engine were just set up with. The dynamic Peak is taken at its
+    //static gain, the most it ever boosts or cuts
+    autoGainResponse.clear();
+    addCutResponse(autoGainResponse, leftChain.get<ChainPositions::LowCut>());
+    addCutResponse(autoGainResponse, leftChain.get<ChainPositions::HighCut>());
+
+    if (chainSettings.peakDynamic)
+    {
+        float peak[CoefficientDesign::NumCoefficients];
+        CoefficientDesign::makePeak(peak, getSampleRate(), chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDecibels);
+        autoGainResponse.addSection(peak);
+    }
+    else if (!leftChain.isBypassed<ChainPositions::Peak>())
+        autoGainResponse.addSection(leftChain.get<ChainPositions::Peak>().coefficients->coefficients.getRawDataPointer());
+
+    for (int i = 0; i < bandEngine.getNumActiveBands(); ++i)
+        autoGainResponse.addSection(bandEngine.getActiveCoefficients(i));
+
+    const auto decibels = autoGainResponse.getCompensationDecibels();
+    autoGainDecibels.store(decibels, std::memory_order_relaxed);
+    autoGainTarget = juce::Decibels::decibelsToGain(decibels);
+}
+void SimpleEQAudioProcessor::applyAutoGain(juce::AudioBuffer<float>& buffer)
+{
+    autoGain.setTargetValue(parameters.get<Parameters::AutoGain>() ? autoGainTarget : 1.f);
+
+    const auto numSamples = buffer.getNumSamples();
+    if (autoGain.isSmoothing())
+    {
+        const auto startGain = autoGain.getCurrentValue();
+        const auto endGain = autoGain.skip(numSamples);
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            buffer.applyGainRamp(channel, 0, numSamples, startGain, endGain);
+    }
+    else if (autoGain.getCurrentValue() != 1.f) //Off, or a flat curve: nothing at all per sample
+    {
+        buffer.applyGain(autoGain.getCurrentValue());
+    }
+}
+MemoryReport SimpleEQAudioProcessor::getMemoryReport()
+{
+    MemoryReport report;
+    report.add("processor", sizeof(*this)); //Filter chains, band engine, timing histogram...
+    report.add("coefficient cache (shared)", coefficientCache->getMemoryUsage());
+    report.add("crossfade buffers", MemoryUsage::of(dryBuffer) + MemoryUsage::of(outgoingBuffer) + MemoryUsage::of(fadeRamp));
+    report.add("analyser capture", leftChannelFifo.getMemoryUsage() + rightChannelFifo.getMemoryUsage() + prePostFifo.getMemoryUsage());
+
+    if (auto* editor = dynamic_cast<SimpleEQAudioProcessorEditor*>(getActiveEditor()))
+        editor->addMemoryUsage(report);
+    return report;
+}
+void SimpleEQAudioProcessor::updateBands()
+{
+    for (int i = 0; i < BandEngine::MaxBands; ++i)
+    {
+        const auto settings = bandParameters.get(i);
+        if (settings != bandEngine.getBand(i))
+        {
+            bandEngine.setBand(i, settings); //Only the bands that changed are redesigned
+            autoGainNeedsUpdate = true;
+        }
+    }
 }
 AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::createParameterLayout() //Sync Parameters in the GUI and the variale in the DSP
 {
     AudioProcessorValueTreeState::ParameterLayout layout;                                      //Creation of the parameters
 
-    layout.add(std::make_unique<AudioParameterFloat>("LowCut Freq", "LowCut Freq",
-        NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20.f));
-    layout.add(std::make_unique<AudioParameterFloat>("HighCut Freq", "HighCut Freq",
-        NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20000.f));
-    layout.add(std::make_unique<AudioParameterFloat>("Peak Freq", "Peak Freq",
-        NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 750.f));
-    layout.add(std::make_unique<AudioParameterFloat>("Peak Gain", "Peak Gain",
-        NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f), 0.0f));
-    layout.add(std::make_unique<AudioParameterFloat>("Peak Quality", "Peak Quality",
-        NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f), 1.f));
-    StringArray stringArray;
-    for (int i = 0; i < 4; ++i)
-    {
-        String str;
-        str << (12 + i * 12);
-        str << " dB/Oct";
-        stringArray.add(str);
-    }
-    layout.add(std::make_unique<AudioParameterChoice>("LowCut Slope", "LowCut Slope", stringArray, 0));
-    layout.add(std::make_unique<AudioParameterChoice>("HighCut Slope", "HighCut Slope", stringArray, 0));
+    Parameters::addToLayout(layout); //The main parameters, see Parameters.h
+    addBandParameters(layout);
     return layout;
 }
 //==============================================================================
@@ -6,14 +6,34 @@
 #pragma once
 #include <JuceHeader.h>
 #include <array>
+#include <atomic>
+#include "BandEngine.h"
+#include "Parameters.h"
+#include "AutoGain.h"
+#include "CoefficientCache.h"
+#include "CoefficientDesign.h"
+#include "FilterAnalysis.h"
+#include "StateFormat.h"
+#include "PresetBank.h"
+#include "RealtimeCheck.h"
+#include "ProcessTiming.h"
+#include "MemoryReport.h"
+/*
+Single reader, single writer queue of whole elements (audio buffers, FFT frames, paths). The depth is the
+number of slots, set before use: the AbstractFifo keeps one free, so it holds depth - 1 elements. Every slot
+is allocated up front by prepare(), so push() and pull() only copy into memory that is already there.
+*/
 template<typename T>
 struct Fifo
 {
-    void prepare(int numChannels, int numSamples)
+    static constexpr int DefaultDepth = 30; //What every queue had before the depth could be set
+
+    void prepare(int numChannels, int numSamples, int depth = DefaultDepth)
     {
     static_assert(std::is_same_v<T, juce::AudioBuffer<float>>,
         "prepare(numElements) should only be used when the Fifo is holding juce::AudioBuffer<float>");
     
+    setDepth(depth);
     for (auto& buffer : buffers)
         {
             buffer.setSize(numChannels,    
@@ -25,46 +45,74 @@ struct Fifo
         }
     }
 
-    void prepare(size_t numElements)
+    void prepare(size_t numElements, int depth = DefaultDepth)
     {
-        static_assert(std::is_same_v<T, std::vector<float>>,
-            "prepare(numElements) should only be used when the Fifo is holding std::vecot  <float>");
+        static_assert(std::is_same_v<T, std::vector<typename T::value_type>>,
+            "prepare(numElements) should only be used when the Fifo is holding a std::vector");
+        setDepth(depth);
         for (auto& buffer : buffers)
         {
             buffer.clear();
-            buffer.resize(numElements, 0);
+            buffer.resize(numElements, {});
+            buffer.shrink_to_fit(); //A frame that used to be bigger gives its memory back
         }
     }
+
+    //Drops whatever was queued. Not while either side is using the queue
+    void setDepth(int depth)
+    {
+        jassert(depth >= 2);
+        buffers.resize((size_t)depth);
+        buffers.shrink_to_fit();
+        timestamps.assign((size_t)depth, 0);
+        fifo.setTotalSize(depth);
+        fifo.reset();
+    }
+    int getDepth() const { return (int)buffers.size(); }
     
-    bool push(const T& t)
+    //The timestamp travels with the element, so the analyser can tell how old what it draws is
+    bool push(const T& t, juce::int64 timestamp = 0)
     {
         auto write = fifo.write(1);
         if (write.blockSize1 > 0)
         {
             buffers[write.startIndex1] = t;
+            timestamps[write.startIndex1] = timestamp;
             return true;
         }
         return false;
     }
 
-    bool pull(T& t)
+    bool pull(T& t, juce::int64* timestamp = nullptr)
     {
         auto read = fifo.read(1);
         if (read.blockSize1 > 0)
         {
             t = buffers[read.startIndex1];
+            if (timestamp != nullptr)
+                *timestamp = timestamps[read.startIndex1];
             return true;
         }
+        return false;
     }
 
     int getNumAvailableForReading() const
     {
         return fifo.getNumReady();
     }
+
+    //Every slot, with what it holds right now. Message thread, for MemoryReport
+    size_t getMemoryUsage() const
+    {
+        auto bytes = MemoryUsage::of(buffers) + MemoryUsage::of(timestamps);
+        for (auto& buffer : buffers)
+            bytes += MemoryUsage::of(buffer);
+        return bytes;
+    }
 private:
-    static constexpr int Capacity = 30;
-    std::array<T, Capacity> buffers;
-    juce::AbstractFifo fifo{ Capacity };
+    std::vector<T> buffers = std::vector<T>((size_t)DefaultDepth);
+    std::vector<juce::int64> timestamps = std::vector<juce::int64>((size_t)DefaultDepth, 0);
+    juce::AbstractFifo fifo{ DefaultDepth };
 };
 
 enum Channel //FFT works for each channel of audio
@@ -86,13 +134,34 @@ struct SingleChannelSampleFifo
         jassert(prepared.get());
         jassert(buffer.getNumChannels() > channelToUse);
         auto* channelPtr = buffer.getReadPointer(channelToUse);
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        auto numSamples = buffer.getNumSamples();
+
+        //In runs up to the end of bufferToFill, one vector copy each instead of a setSample per sample
+        while (numSamples > 0)
         {
-            pushNextSampleIntoFifo(channelPtr[i]);
+            if (fifoIndex == bufferToFill.getNumSamples())
+                pushFullBuffer();
+
+            const auto run = juce::jmin(numSamples, bufferToFill.getNumSamples() - fifoIndex);
+            juce::FloatVectorOperations::copy(bufferToFill.getWritePointer(0, fifoIndex), channelPtr, run);
+            fifoIndex += run;
+            channelPtr += run;
+            numSamples -= run;
         }
     }
 
-    void prepare(int bufferSize)
+    //Called from the audio thread when capture resumes, so a half filled buffer of old audio isn't sent to the analyser
+    void restart() { fifoIndex = 0; }
+
+    //Called from the reader side when it starts listening, to throw away buffers captured before it existed
+    void discardAvailableBuffers()
+    {
+        BlockType stale;
+        while (getNumCompleteBufferAvailable() > 0)
+            getAudioBuffer(stale);
+    }
+
+    void prepare(int bufferSize, int depth = Fifo<BlockType>::DefaultDepth)
     {
         prepared.set(false);
         size.set(bufferSize);
@@ -102,7 +171,7 @@ struct SingleChannelSampleFifo
                              false,              //KeepExistingContent
                              true,               //clear extra space
                              true);              //avoid reallocating
-        audioBufferFifo.prepare(1, bufferSize);
+        audioBufferFifo.prepare(1, bufferSize, depth);
         fifoIndex = 0;
         prepared.set(true);
     }
@@ -110,8 +179,13 @@ struct SingleChannelSampleFifo
     int getNumCompleteBufferAvailable() const { return audioBufferFifo.getNumAvailableForReading(); }
     bool isPrepared() const { return prepared.get(); }
     int getSize() const { return size.get(); }
+    size_t getMemoryUsage() const { return MemoryUsage::of(bufferToFill) + audioBufferFifo.getMemoryUsage(); }
     //==============================================================================
-    bool getAudioBuffer(BlockType& buf) { return audioBufferFifo.pull(buf); }
+    bool getAudioBuffer(BlockType& buf, juce::int64* captureTicks = nullptr) { return audioBufferFifo.pull(buf, captureTicks); }
+
+    //Written by the audio thread only, readable from anywhere
+    juce::uint64 getNumCapturedBuffers() const { return capturedBuffers.load(std::memory_order_relaxed); }
+    juce::uint64 getNumDroppedBuffers() const { return droppedBuffers.load(std::memory_order_relaxed); } //The fifo was full
 
 private:
     Channel channelToUse;
@@ -120,20 +194,97 @@ private:
     BlockType bufferToFill;
     juce::Atomic<bool> prepared = false;
     juce::Atomic<int> size = 0;
+    std::atomic<juce::uint64> capturedBuffers{ 0 }, droppedBuffers{ 0 };
 
-    void pushNextSampleIntoFifo(float sample)
+    void pushFullBuffer()
     {
-        if (fifoIndex == bufferToFill.getNumSamples())
+        auto ok = audioBufferFifo.push(bufferToFill, juce::Time::getHighResolutionTicks());
+
+        auto& counter = ok ? capturedBuffers : droppedBuffers; //Single writer, no read-modify-write needed
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        fifoIndex = 0;
+    }
+};
+
+/*
+The pre EQ tap for the analyser's Pre and Diff views. Every buffer holds the mid (L + R) / 2 of the input
+in channel 0 and the mid of the output in channel 1, over the same samples, so the editor never has to
+line two fifos up against each other. capturePre() keeps the input's mid of the current block until
+capturePost() writes both into the fifo buffer: about one channel's worth of copying more than the
+two channel fifos, not another two channels.
+*/
+template<typename BlockType>
+struct PrePostSampleFifo
+{
+    void prepare(int bufferSize, int maxBlockSize, int depth = Fifo<BlockType>::DefaultDepth)
+    {
+        prepared.set(false);
+        bufferToFill.setSize(2, bufferSize, false, true, true);
+        preMid.setSize(1, maxBlockSize, false, true, true);
+        audioBufferFifo.prepare(2, bufferSize, depth);
+        fifoIndex = 0;
+        prepared.set(true);
+    }
+
+    void restart() { fifoIndex = 0; } //Audio thread, as SingleChannelSampleFifo::restart()
+
+    void discardAvailableBuffers()
+    {
+        BlockType stale;
+        while (getNumCompleteBufferAvailable() > 0)
+            getAudioBuffer(stale);
+    }
+
+    //Before the block is processed
+    void capturePre(const BlockType& buffer)
+    {
+        jassert(prepared.get() && buffer.getNumSamples() <= preMid.getNumSamples());
+        writeMid(buffer, 0, preMid.getWritePointer(0), buffer.getNumSamples());
+    }
+
+    //After it is processed, the same samples
+    void capturePost(const BlockType& buffer)
+    {
+        jassert(prepared.get());
+        const auto numSamples = buffer.getNumSamples();
+
+        for (int done = 0; done < numSamples;)
         {
-            auto ok = audioBufferFifo.push(bufferToFill);
+            if (fifoIndex == bufferToFill.getNumSamples())
+            {
+                audioBufferFifo.push(bufferToFill, juce::Time::getHighResolutionTicks());
+                fifoIndex = 0;
+            }
+
+            const auto run = juce::jmin(numSamples - done, bufferToFill.getNumSamples() - fifoIndex);
+            juce::FloatVectorOperations::copy(bufferToFill.getWritePointer(0, fifoIndex), preMid.getReadPointer(0, done), run);
+            writeMid(buffer, done, bufferToFill.getWritePointer(1, fifoIndex), run);
+            fifoIndex += run;
+            done += run;
+        }
+    }
+
+    int getNumCompleteBufferAvailable() const { return audioBufferFifo.getNumAvailableForReading(); }
+    bool getAudioBuffer(BlockType& buf, juce::int64* captureTicks = nullptr) { return audioBufferFifo.pull(buf, captureTicks); }
+    size_t getMemoryUsage() const { return MemoryUsage::of(bufferToFill) + MemoryUsage::of(preMid) + audioBufferFifo.getMemoryUsage(); }
 
-            juce::ignoreUnused(ok);
+private:
+    int fifoIndex = 0;
+    Fifo<BlockType> audioBufferFifo;
+    BlockType bufferToFill, preMid;
+    juce::Atomic<bool> prepared = false;
 
-            fifoIndex = 0;
+    static void writeMid(const BlockType& buffer, int start, float* destination, int numSamples)
+    {
+        if (buffer.getNumChannels() < 2)
+        {
+            juce::FloatVectorOperations::copy(destination, buffer.getReadPointer(0, start), numSamples);
+            return;
         }
 
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
+        juce::FloatVectorOperations::add(destination, buffer.getReadPointer(0, start), buffer.getReadPointer(1, start), numSamples);
+        juce::FloatVectorOperations::multiply(destination, 0.5f, numSamples);
     }
 };
 
@@ -149,8 +300,26 @@ struct ChainSettings //Extract our parameters from the AudioProcesorValueTreeSta
     float peakFreq{ 0 }, peakGainInDecibels{ 0 }, peakQuality{ 1.f };
     float lowCutFreq{ 0 }, highCutFreq{ 0 };
     Slope lowCutSlope{ Slope::Slope_12 }, highCutSlope{ Slope::Slope_12 };
+    //Dynamic mode of the Peak band: the level around the peak frequency pulls 'Peak Gain' down like a compressor
+    bool peakDynamic{ false }, peakUseSidechain{ false };
+    float peakThresholdInDecibels{ 0 }, peakRatio{ 1.f }, peakAttackMs{ 10.f }, peakReleaseMs{ 100.f };
+
+    bool operator== (const ChainSettings& other) const
+    {
+        return peakFreq == other.peakFreq && peakGainInDecibels == other.peakGainInDecibels && peakQuality == other.peakQuality
+            && lowCutFreq == other.lowCutFreq && highCutFreq == other.highCutFreq
+            && lowCutSlope == other.lowCutSlope && highCutSlope == other.highCutSlope
+            && peakDynamic == other.peakDynamic && peakUseSidechain == other.peakUseSidechain
+            && peakThresholdInDecibels == other.peakThresholdInDecibels && peakRatio == other.peakRatio
+            && peakAttackMs == other.peakAttackMs && peakReleaseMs == other.peakReleaseMs;
+    }
+    bool operator!= (const ChainSettings& other) const { return !(*this == other); }
 };
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+ChainSettings getChainSettings(const Parameters::Handles& parameters); //A relaxed load per parameter, safe on the audio thread
+
+//A Peak that leaves the signal as it is is taken out of the chain instead of being run. The cuts always run:
+//even at the end stops of their ranges they take something off the audible band (-3 dB at 20 Hz for a 12 dB/Oct low cut)
+inline bool isPeakActive(const ChainSettings& chainSettings) { return chainSettings.peakDynamic || !isUnityGain(chainSettings.peakGainInDecibels); }
 
 using Filter = juce::dsp::IIR::Filter<float>;  // 12dB per octave
 using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
@@ -205,6 +374,53 @@ void updateCutFilter(ChainType& leftLowCut, const CoefficientType& cutCoefficien
     }
     }
 }
+//What updateCutFilter() does with FilterDesign's Butterworth sections, but designed straight into the chain.
+//For the audio thread when the cache doesn't have the design: every stage has to be second order already
+template<int Index, typename ChainType>
+void designCutStage(ChainType& cut, bool highPass, float freq, int order, double sampleRate)
+{
+    auto& c = cut.template get<Index>().coefficients->coefficients;
+    jassert(c.size() == CoefficientDesign::NumCoefficients);
+
+    const auto quality = CoefficientDesign::getButterworthQuality(order, Index);
+    if (highPass)
+        CoefficientDesign::makeHighPass(c.getRawDataPointer(), sampleRate, freq, quality);
+    else
+        CoefficientDesign::makeLowPass(c.getRawDataPointer(), sampleRate, freq, quality);
+
+    cut.template setBypassed<Index>(false);
+}
+template<typename ChainType>
+void designCutFilter(ChainType& cut, bool highPass, float freq, const Slope& slope, double sampleRate)
+{
+    cut.template setBypassed<0>(true);
+    cut.template setBypassed<1>(true);
+    cut.template setBypassed<2>(true);
+    cut.template setBypassed<3>(true);
+
+    const auto order = 2 * (slope + 1);
+    switch (slope) //Same fallthrough as updateCutFilter
+    {
+    case Slope_48: designCutStage<3>(cut, highPass, freq, order, sampleRate);
+    case Slope_36: designCutStage<2>(cut, highPass, freq, order, sampleRate);
+    case Slope_24: designCutStage<1>(cut, highPass, freq, order, sampleRate);
+    case Slope_12: designCutStage<0>(cut, highPass, freq, order, sampleRate);
+    }
+}
+//The other channel gets the same sections: copied instead of designed a second time
+template<typename ChainType>
+void copyCutFilter(const ChainType& source, ChainType& cut)
+{
+    updateCoefficients(cut.template get<0>().coefficients, source.template get<0>().coefficients);
+    updateCoefficients(cut.template get<1>().coefficients, source.template get<1>().coefficients);
+    updateCoefficients(cut.template get<2>().coefficients, source.template get<2>().coefficients);
+    updateCoefficients(cut.template get<3>().coefficients, source.template get<3>().coefficients);
+
+    cut.template setBypassed<0>(source.template isBypassed<0>());
+    cut.template setBypassed<1>(source.template isBypassed<1>());
+    cut.template setBypassed<2>(source.template isBypassed<2>());
+    cut.template setBypassed<3>(source.template isBypassed<3>());
+}
 inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
 {
     return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
@@ -218,10 +434,58 @@ return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMetho
                                                                                   sampleRate,
                                                                                   2 * (chainSettings.highCutSlope + 1));
 }
+//Same designs, looked up in the cache first. The cut versions design into 'scratch' when the cache has no room left
+inline const CutCoefficients& makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate, CoefficientCache& cache, CutCoefficients& scratch)
+{
+    return cache.getLowCut(chainSettings.lowCutFreq, 2 * (chainSettings.lowCutSlope + 1), sampleRate, scratch);
+}
+inline const CutCoefficients& makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate, CoefficientCache& cache, CutCoefficients& scratch)
+{
+    return cache.getHighCut(chainSettings.highCutFreq, 2 * (chainSettings.highCutSlope + 1), sampleRate, scratch);
+}
+inline Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate, CoefficientCache& cache)
+{
+    return cache.getPeak(chainSettings.peakFreq, chainSettings.peakQuality, chainSettings.peakGainInDecibels, sampleRate);
+}
+/*
+Dynamic Peak band. An envelope follower on the input (or the sidechain) sets the Peak gain once per sub-block.
+Frequency and Q are fixed during a block, so the RBJ peak design only needs its gain term recomputed:
+updatePeakGain() writes the new coefficients in place, no makePeakFilter() and no allocation on the audio thread.
+*/
+struct DynamicPeak
+{
+    static constexpr int SubBlockSize = 16; //Two gain updates per 32 sample buffer
+
+    void prepare(double sampleRate);
+    void reset();
+    void setParameters(const ChainSettings& chainSettings); //Audio thread, once per block
+
+    //Runs the detector over [startSample, startSample + numSamples) and returns the Peak gain to use for that sub-block
+    float processDetector(const juce::AudioBuffer<float>& detector, int startSample, int numSamples);
+    //Recomputes the peak coefficients for a new gain, in place
+    void updatePeakGain(Coefficients& coefficients, float gainInDecibels) const;
+
+private:
+    double sampleRate = 44100.0;
+    float freq = -1.f, quality = -1.f;  //What cosOmega and alpha were computed for
+    float cosOmega = 1.f, alpha = 0.f;
+    float attackMs = -1.f, releaseMs = -1.f;
+    float attackCoeff = 0.f, releaseCoeff = 0.f;
+    float thresholdInDecibels = 0.f, slope = 0.f, staticGainInDecibels = 0.f;
+
+    //Band pass around the peak frequency, so only the level of what the band acts on drives it
+    float bp0 = 0.f, bp2 = 0.f, bpA1 = 0.f, bpA2 = 0.f; //b1 of the RBJ band pass is 0
+    float z1 = 0.f, z2 = 0.f;
+    float envelope = 0.f;
+};
+
 //==============================================================================
 /**
 */
 class SimpleEQAudioProcessor : public juce::AudioProcessor
+                             #if SIMPLEEQ_RT_CHECKS
+                               , private juce::Timer //Only there to report RealtimeCheck violations
+                             #endif
 {
 public:
     //==============================================================================
@@ -234,6 +498,8 @@ public:
     bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 #endif
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    juce::AudioProcessorParameter* getBypassParameter() const override;
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -254,11 +520,60 @@ public:
     void setStateInformation(const void* data, int sizeInBytes) override;
     static AudioProcessorValueTreeState::ParameterLayout createParameterLayout(); //needs to be public so the GUI can attach all the knobs and combo boxes etc
     AudioProcessorValueTreeState apvts{ *this, nullptr, "Parameters", createParameterLayout() };
+    const Parameters::Handles parameters{ apvts }; //The main parameters' values, resolved once
+    const BandParameters bandParameters{ apvts };  //Same for the extra bands
    
     using BlockType = juce::AudioBuffer<float>;
     SingleChannelSampleFifo <BlockType> leftChannelFifo { Channel::Left }; 
     SingleChannelSampleFifo <BlockType> rightChannelFifo { Channel::Right };
+
+    //The fifos above are only filled while something is reading them. Every analyser registers itself here (message thread),
+    //so with no editor open the capture in processBlock is a single atomic load
+    void addAnalyserConsumer() { analyserConsumers.fetch_add(1); }
+    void removeAnalyserConsumer() { analyserConsumers.fetch_sub(1); }
+
+    //The pre EQ tap, filled only while an analyser is listening and something has also asked for it here
+    PrePostSampleFifo<BlockType> prePostFifo;
+    void addPreEQConsumer() { preEQConsumers.fetch_add(1); }
+    void removePreEQConsumer() { preEQConsumers.fetch_sub(1); }
+
+    MemoryReport getMemoryReport(); //Message thread. This instance, with its editor's analyser if one is open
+    float getAutoGainDecibels() const { return parameters.get<Parameters::AutoGain>() ? autoGainDecibels.load(std::memory_order_relaxed) : 0.f; }
+    CoefficientCache& getCoefficientCache() { return *coefficientCache; } //Shared with the response curve and the other instances, safe from any thread
+    int getNumActiveBiquads() const { return numActiveBiquads.load(std::memory_order_relaxed); } //Per channel, in the last block
+    BlockTimingHistogram& getBlockTiming() { return blockTiming; } //How long each processBlock call took, for the overlay and the tools
+
+    //A/B/C/D comparison slots. Selecting a slot keeps the edits made in the one being left,
+    //an empty slot starts as a copy of the current settings. Bypass and Auto Gain stay out of slots and presets. Message thread
+    static constexpr int NumSlots = 4;
+    void selectSlot(int slot);
+    int getCurrentSlot() const { return currentSlot; }
+    int savePreset(const juce::String& name); //Adds the current settings to the preset bank, returns the program index
+    const PresetBank& getPresetBank() const { return *presetBank; }
+    //Sent when the program, the preset list or the slots change, whoever changed them (the host included)
+    juce::ChangeBroadcaster presetChanges;
 private:
+    juce::SharedResourcePointer<CoefficientCache> coefficientCache; //One table for every instance in the process
+    std::atomic<int> analyserConsumers{ 0 };
+    std::atomic<int> preEQConsumers{ 0 };
+    bool analyserWasCapturing = false, preEQWasCapturing = false; //Audio thread only, what this block captures
+    void beginAnalyserCapture(); //Once per block, before the pre EQ capture, so every tap takes the same blocks
+    void captureForAnalyser(const juce::AudioBuffer<float>& buffer);
+    std::atomic<int> numActiveBiquads{ 0 };
+    BlockTimingHistogram blockTiming;
+
+    //Everything sized in prepareToPlay holds this many samples. Hosts are allowed to send bigger blocks than they
+    //announced (and some do, on a sample rate or buffer change), processBlock cuts those into pieces this size
+    static constexpr int minPreparedBlockSize = 512; //A host that announces a tiny size doesn't get its blocks chopped that small
+    static constexpr int analyserBufferSize = 512;   //Capture size of the fifos, independent of the host's block size
+    //Slots in each capture fifo: about 100 ms of audio, which covers an editor the scheduler skips for a few frames
+    static int getAnalyserQueueDepth(double sampleRate)
+    {
+        return juce::jlimit(4, Fifo<BlockType>::DefaultDepth, (int)std::ceil(0.1 * sampleRate / analyserBufferSize) + 2);
+    }
+    int preparedBlockSize = minPreparedBlockSize;
+    void processPreparedBlock(juce::AudioBuffer<float>& buffer); //At most preparedBlockSize samples
+    static void makeSecondOrder(MonoChain& chain); //So the audio thread can always design in place
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SimpleEQAudioProcessor)
         //Declaration of the Filters:
@@ -308,7 +623,84 @@ private:
  
     void updateLowCutFilters(const ChainSettings& chainSettings);
     void updateHighCutFilters(const ChainSettings& chainSettings);
-    void updateFilters();
+    ChainSettings updateFilters();
+    ChainSettings currentSettings; //Audio thread, the last consistent snapshot of the parameters
+
+    //setStateInformation() makes this odd while it sets the parameters one by one, and even again when it's done.
+    //updateFilters() keeps the previous snapshot while it's odd (or changed under it), so a block never mixes two states
+    std::atomic<juce::uint32> stateLoadSequence{ 0 };
+    StateFormat stateFormat{ *this, Parameters::getSessionOnlyIDs() };
+    //Every state load goes through here. The coefficients for the new values are designed into the cache
+    //before the audio thread can see them, so the switch itself is only cache lookups. Snapshots are crossfaded
+    void applyState(const void* data, int sizeInBytes, StateFormat::Scope scope);
+
+    juce::SharedResourcePointer<PresetBank> presetBank;
+    int currentProgram = 0;
+    std::array<juce::MemoryBlock, NumSlots> slots;
+    int currentSlot = 0;
+
+    //Switching slot or preset: the old filters keep running in the outgoing chains, on a copy of the input,
+    //while the live chains start from silence with the new settings, and the two are crossfaded
+    static constexpr double switchFadeSeconds = 0.02;
+    std::atomic<juce::uint32> stateSwitches{ 0 }; //Bumped inside the stateLoadSequence bracket
+    juce::uint32 stateSwitchesSeen = 0;
+    MonoChain outgoingLeftChain, outgoingRightChain;
+    juce::AudioBuffer<float> outgoingBuffer;
+    juce::LinearSmoothedValue<float> switchMix; //0 outgoing, 1 live
+    void mixOutgoingChains(juce::dsp::AudioBlock<float>& block); //outgoingBuffer holds a copy of the input
+    template<int Position>
+    void setChainPositionActive(bool shouldBeActive);
+    int chainBiquads = 0; //Per channel, counted by updateFilters()
+    void resetProcessing(); //Clears the state of every filter
+    void warmCoefficientCache(double sampleRate);
+
+    DynamicPeak dynamicPeak;
+    void processChainsWithDynamicPeak(juce::dsp::AudioBlock<float>& block, const juce::AudioBuffer<float>& detector);
+
+    //Silence detection. The tail is how long the current cascade rings, worked out from its pole radii.
+    //Once the input has been silent for longer than that, processBlock returns straight away
+    static constexpr float silenceThreshold = 1.0e-6f; //-120 dB, the same level the tail is measured down to
+    //What the host is told is capped: an unstable or barely stable pole has an endless tail, and a host keeping the
+    //plugin running for hours after the playhead stops helps nobody. The silence skipping uses the real length
+    static constexpr double maxReportedTailSeconds = 4.0;
+    std::atomic<double> tailLengthSeconds{ 0.0 };
+    double chainTailSamples = 0.0, tailLengthInSamples = 0.0;
+    ChainSettings tailSettings;
+    bool tailNeedsUpdate = true;
+    juce::int64 silentSamples = 0;
+    bool processingIsIdle = false;
+    void updateTailLength(const ChainSettings& chainSettings);
+    bool skipSilentBlock(const juce::AudioBuffer<float>& buffer);
+
+    //Host bypass. Switching it crossfades between the filtered and the dry signal, once it's engaged
+    //the buffer already holds the dry input and processBlock returns without running anything
+    static constexpr double bypassFadeSeconds = 0.02;
+    bool hostBypassed = false; //Set while processBlockBypassed() runs processBlock()
+    juce::LinearSmoothedValue<float> bypassMix; //0 filtered, 1 dry
+    juce::AudioBuffer<float> dryBuffer;
+    std::vector<float> fadeRamp; //Per sample gains of whichever crossfade is running, shared by the channels
+
+    //Auto Gain. The compensation is worked out on the audio thread from the coefficients it runs (see AutoGain.h),
+    //in the same block updateFilters() or updateBands() changed them, so the gain always matches the curve
+    static constexpr double autoGainRampSeconds = 0.05;
+    std::atomic<float> autoGainDecibels{ 0.f }; //For the response curve
+    AutoGain::Response autoGainResponse;
+    ChainSettings autoGainSettings;             //What autoGainTarget was worked out for
+    bool autoGainNeedsUpdate = true;            //Set by prepareToPlay() and updateBands()
+    float autoGainTarget = 1.f;
+    void updateAutoGain(const ChainSettings& chainSettings);
+    juce::LinearSmoothedValue<float> autoGain;
+    void applyAutoGain(juce::AudioBuffer<float>& buffer);
+
+    //The extra bands belong to the audio thread: their parameters are read every block, like the main
+    //chain's, and only the bands that changed are redesigned
+    BandEngine bandEngine;
+    void updateBands();
+
+   #if SIMPLEEQ_RT_CHECKS
+    void timerCallback() override;
+    int reportedViolations = 0; //RealtimeCheck violations already printed by the timer
+   #endif
 
     juce::dsp::Oscillator<float> osc  ; //Test signal
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+    Preset bank, kept in one memory mapped file shared by every instance.
+  ==============================================================================
+*/
+#include "PresetBank.h"
+#include <cstring>
+
+static constexpr int HeaderSize = 8;
+static constexpr int RecordSize = PresetBank::NameSize + 8;
+
+PresetBank::PresetBank() : file(getDefaultFile())
+{
+    load();
+}
+
+juce::File PresetBank::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("SimpleEQ")
+        .getChildFile("Presets.seqbank");
+}
+
+void PresetBank::load()
+{
+    presets.clear();
+    map.reset();
+
+    if (!file.existsAsFile())
+        return;
+
+    map = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const char*>(map->getData());
+    auto size = map->getSize();
+
+    if (data == nullptr || size < (size_t)HeaderSize || juce::ByteOrder::littleEndianInt(data) != Magic
+        || juce::ByteOrder::littleEndianShort(data + 4) > Version)
+    {
+        map.reset();
+        return;
+    }
+
+    auto numPresets = (int)juce::ByteOrder::littleEndianShort(data + 6);
+    if (size < (size_t)(HeaderSize + RecordSize * numPresets))
+    {
+        jassertfalse; //Cut short
+        map.reset();
+        return;
+    }
+
+    for (int i = 0; i < numPresets; ++i)
+    {
+        auto* record = data + HeaderSize + RecordSize * i;
+        Preset preset;
+        preset.name = juce::String::fromUTF8(record, (int)strnlen(record, NameSize));
+        preset.offset = juce::ByteOrder::littleEndianInt(record + NameSize);
+        preset.size = juce::ByteOrder::littleEndianInt(record + NameSize + 4);
+
+        if ((size_t)preset.offset + preset.size <= size) //Skip anything pointing outside the file
+            presets.push_back(preset);
+    }
+}
+
+juce::String PresetBank::getName(int index) const
+{
+    if (!juce::isPositiveAndBelow(index, getNumPresets()))
+        return {};
+
+    return usesFactoryPresets() ? factory[(size_t)index].first : presets[(size_t)index].name;
+}
+
+bool PresetBank::getPresetData(int index, const void*& data, int& sizeInBytes) const
+{
+    if (!juce::isPositiveAndBelow(index, getNumPresets()))
+        return false;
+
+    if (usesFactoryPresets())
+    {
+        data = factory[(size_t)index].second.getData();
+        sizeInBytes = (int)factory[(size_t)index].second.getSize();
+        return true;
+    }
+
+    if (map == nullptr)
+        return false;
+
+    auto& preset = presets[(size_t)index];
+    data = static_cast<const char*>(map->getData()) + preset.offset;
+    sizeInBytes = (int)preset.size;
+    return true;
+}
+
+int PresetBank::addPreset(const juce::String& name, const juce::MemoryBlock& state)
+{
+    std::vector<std::pair<juce::String, juce::MemoryBlock>> contents;
+    for (int i = 0; i < getNumPresets(); ++i)
+    {
+        const void* data = nullptr;
+        int size = 0;
+        getPresetData(i, data, size);
+        contents.emplace_back(getName(i), juce::MemoryBlock(data, (size_t)size));
+    }
+
+    contents.emplace_back(name, state);
+    write(contents);
+    return getNumPresets() - 1;
+}
+
+void PresetBank::setFactoryPresets(std::vector<std::pair<juce::String, juce::MemoryBlock>> factoryPresets)
+{
+    factory = std::move(factoryPresets);
+}
+
+void PresetBank::write(const std::vector<std::pair<juce::String, juce::MemoryBlock>>& contents)
+{
+    juce::MemoryBlock block;
+    juce::MemoryOutputStream out(block, false);
+
+    out.writeInt((int)Magic);
+    out.writeShort((short)Version);
+    out.writeShort((short)contents.size());
+
+    auto offset = (juce::uint32)(HeaderSize + RecordSize * (int)contents.size());
+    for (auto& preset : contents)
+    {
+        char name[NameSize] = {};
+        preset.first.copyToUTF8(name, NameSize); //Keeps the terminating zero, so at most NameSize - 1 bytes of name
+        out.write(name, NameSize);
+        out.writeInt((int)offset);
+        out.writeInt((int)preset.second.getSize());
+        offset += (juce::uint32)preset.second.getSize();
+    }
+
+    for (auto& preset : contents)
+        out.write(preset.second.getData(), preset.second.getSize());
+
+    out.flush();
+
+    map.reset(); //Some systems won't replace a file that is still mapped
+    file.getParentDirectory().createDirectory();
+    file.replaceWithData(block.getData(), block.getSize());
+    load();
+}
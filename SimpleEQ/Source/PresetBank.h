@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+    Preset bank, kept in one memory mapped file shared by every instance.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+/*
+File layout, all little endian:
+    uint32  Magic ("SEQP")
+    uint16  Version
+    uint16  number of presets
+    then per preset: char name[NameSize] (UTF-8, zero padded), uint32 offset, uint32 size
+    then the presets themselves, each one a StateFormat block
+
+The file is mapped read only, so opening the bank costs the same with 3 presets or 300
+and a preset is read straight out of the mapping when it's loaded.
+Until there is a file, the bank lists the factory presets from memory: nothing touches the disk before
+the user saves a preset, and that first save writes the factory presets along with it.
+Use it through a juce::SharedResourcePointer so every instance in the process shares one mapping.
+Message thread only.
+*/
+class PresetBank
+{
+public:
+    static constexpr juce::uint32 Magic = 0x50514553; //"SEQP" read as a little endian uint32
+    static constexpr juce::uint16 Version = 1;
+    static constexpr int NameSize = 32;
+
+    PresetBank();
+
+    int getNumPresets() const { return (int)(usesFactoryPresets() ? factory.size() : presets.size()); }
+    juce::String getName(int index) const;
+    //Points into the mapped file (or the factory presets), valid until the bank is changed
+    bool getPresetData(int index, const void*& data, int& sizeInBytes) const;
+
+    //Appends a preset and rewrites the file. Returns its index
+    int addPreset(const juce::String& name, const juce::MemoryBlock& state);
+    //Listed while the bank has no file of its own. Kept in memory only, the first addPreset() writes them out
+    void setFactoryPresets(std::vector<std::pair<juce::String, juce::MemoryBlock>> factoryPresets);
+
+    static juce::File getDefaultFile();
+
+private:
+    struct Preset
+    {
+        juce::String name;
+        juce::uint32 offset, size;
+    };
+
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> map;
+    std::vector<Preset> presets;
+    std::vector<std::pair<juce::String, juce::MemoryBlock>> factory;
+    bool usesFactoryPresets() const { return presets.empty(); }
+
+    void load();
+    void write(const std::vector<std::pair<juce::String, juce::MemoryBlock>>& contents);
+};
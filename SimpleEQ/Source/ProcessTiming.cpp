@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+    processBlock timing histogram.
+  ==============================================================================
+*/
+#include "ProcessTiming.h"
+#include <cmath>
+
+BlockTimingHistogram::ScopedTimer::ScopedTimer(BlockTimingHistogram& h, int numSamples, double sampleRate)
+    : histogram(h),
+      start(juce::Time::getHighResolutionTicks()),
+      deadlineSeconds(sampleRate > 0.0 ? numSamples / sampleRate : 0.0)
+{
+}
+
+BlockTimingHistogram::ScopedTimer::~ScopedTimer()
+{
+    auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    histogram.record(seconds, deadlineSeconds);
+}
+
+void BlockTimingHistogram::record(double seconds, double deadlineSeconds)
+{
+    if (deadlineSeconds <= 0.0) //Empty block
+        return;
+
+    if (resetRequested.exchange(false, std::memory_order_acquire))
+    {
+        for (auto& bin : bins)
+            bin.store(0, std::memory_order_relaxed);
+        numBlocks.store(0, std::memory_order_relaxed);
+        numOverruns.store(0, std::memory_order_relaxed);
+    }
+
+    auto load = (float)(seconds / deadlineSeconds);
+    auto octave = std::log2(juce::jmax(load, 1.0e-9f));
+    auto bin = juce::jlimit(0, NumBins - 1, (int)std::floor((octave - (float)MinOctave) * (float)BinsPerOctave));
+
+    //Single writer, so plain load + store is enough
+    bins[(size_t)bin].store(bins[(size_t)bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    auto count = numBlocks.load(std::memory_order_relaxed);
+    if (count == 0 || load < minLoad.load(std::memory_order_relaxed))
+        minLoad.store(load, std::memory_order_relaxed);
+    if (count == 0 || load > maxLoad.load(std::memory_order_relaxed))
+        maxLoad.store(load, std::memory_order_relaxed);
+    if (load > 1.f)
+        numOverruns.store(numOverruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    numBlocks.store(count + 1, std::memory_order_release);
+}
+
+double BlockTimingHistogram::getBinUpperEdge(int bin)
+{
+    return std::exp2((double)MinOctave + (double)(bin + 1) / (double)BinsPerOctave);
+}
+
+BlockTimingHistogram::Snapshot BlockTimingHistogram::getSnapshot() const
+{
+    Snapshot snapshot;
+
+    std::array<juce::uint32, NumBins> counts;
+    juce::uint64 total = 0;
+    for (int i = 0; i < NumBins; ++i)
+    {
+        counts[(size_t)i] = bins[(size_t)i].load(std::memory_order_relaxed);
+        total += counts[(size_t)i];
+    }
+
+    snapshot.numBlocks = total;
+    if (total == 0)
+        return snapshot;
+
+    snapshot.numOverruns = numOverruns.load(std::memory_order_relaxed);
+    snapshot.min = minLoad.load(std::memory_order_relaxed);
+    snapshot.max = maxLoad.load(std::memory_order_relaxed);
+
+    //A percentile is reported as the upper edge of the bin it falls in, never lower than the truth
+    auto percentile = [&](double fraction)
+    {
+        auto target = (juce::uint64)std::ceil(fraction * (double)total);
+        juce::uint64 seen = 0;
+        for (int i = 0; i < NumBins; ++i)
+        {
+            seen += counts[(size_t)i];
+            if (seen >= target)
+                return juce::jmin(getBinUpperEdge(i), snapshot.max);
+        }
+        return snapshot.max;
+    };
+
+    snapshot.p50 = percentile(0.5);
+    snapshot.p90 = percentile(0.9);
+    snapshot.p99 = percentile(0.99);
+    snapshot.p999 = percentile(0.999);
+    return snapshot;
+}
+
+juce::String BlockTimingHistogram::toString() const
+{
+    auto s = getSnapshot();
+    auto percent = [](double load) { return juce::String(load * 100.0, 2) + "%"; };
+
+    return "blocks " + juce::String((juce::int64)s.numBlocks)
+         + "  min " + percent(s.min)
+         + "  p50 " + percent(s.p50)
+         + "  p90 " + percent(s.p90)
+         + "  p99 " + percent(s.p99)
+         + "  p99.9 " + percent(s.p999)
+         + "  max " + percent(s.max)
+         + "  overruns " + juce::String((juce::int64)s.numOverruns);
+}
+
+void BlockTimingHistogram::reset()
+{
+    resetRequested.store(true, std::memory_order_release);
+}
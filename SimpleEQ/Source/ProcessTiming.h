@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+    processBlock timing histogram.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/*
+Every processBlock call is recorded as a fraction of its deadline (numSamples / sampleRate),
+so 1.0 means the block took all the time the host had for it.
+
+The bins are spaced logarithmically, BinsPerOctave per octave from 2^MinOctave to 2^MaxOctave,
+which keeps the relative error of a percentile under 5% whether a block takes 0.1% or 300% of its deadline.
+Only the audio thread writes; any thread can read a snapshot. A snapshot taken while a block is being
+recorded may be off by that one block, which doesn't matter for percentiles.
+*/
+class BlockTimingHistogram
+{
+public:
+    static constexpr int BinsPerOctave = 16;
+    static constexpr int MinOctave = -14, MaxOctave = 4;
+    static constexpr int NumBins = (MaxOctave - MinOctave) * BinsPerOctave;
+
+    //Audio thread
+    void record(double seconds, double deadlineSeconds);
+
+    struct ScopedTimer //Times everything until the end of the scope, including early returns
+    {
+        ScopedTimer(BlockTimingHistogram& h, int numSamples, double sampleRate);
+        ~ScopedTimer();
+
+        BlockTimingHistogram& histogram;
+        const juce::int64 start;
+        const double deadlineSeconds;
+    };
+
+    //Any thread
+    struct Snapshot
+    {
+        juce::uint64 numBlocks = 0, numOverruns = 0; //Overruns: blocks that took longer than their deadline
+        double min = 0.0, max = 0.0, p50 = 0.0, p90 = 0.0, p99 = 0.0, p999 = 0.0; //Fractions of the deadline
+    };
+    Snapshot getSnapshot() const;
+    juce::String toString() const; //One line summary, for the overlay and the tools
+    void reset();                  //Applied by the audio thread at its next record()
+
+private:
+    std::array<std::atomic<juce::uint32>, NumBins> bins{};
+    std::atomic<juce::uint64> numBlocks{ 0 }, numOverruns{ 0 };
+    std::atomic<float> minLoad{ 0.f }, maxLoad{ 0.f };
+    std::atomic<bool> resetRequested{ false };
+
+    static double getBinUpperEdge(int bin);
+};
@@ -0,0 +1,265 @@
+/*
+  ==============================================================================
+    Real time safety checker for the audio thread.
+  ==============================================================================
+*/
+#include "RealtimeCheck.h"
+
+#if SIMPLEEQ_RT_CHECKS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <pthread.h>
+ #define SIMPLEEQ_RT_CHECK_POSIX 1
+#else
+ #define SIMPLEEQ_RT_CHECK_POSIX 0
+#endif
+
+namespace RealtimeCheck
+{
+    struct Violation
+    {
+        const char* what = nullptr;
+        void* frames[MaxFrames];
+        int numFrames = 0;
+        std::atomic<bool> ready{ false };
+    };
+
+    static Violation records[MaxRecords];
+    static std::atomic<int> numViolations{ 0 };
+
+    //Plain ints with constant initialisers, so reading them never runs any TLS constructor
+    static thread_local int audioThreadDepth = 0;
+    static thread_local bool recording = false;
+
+    static bool isViolation()
+    {
+        return audioThreadDepth > 0 && !recording;
+    }
+
+    static void record(const char* what)
+    {
+        recording = true; //backtrace() or anything below must not report itself
+
+        auto index = numViolations.fetch_add(1);
+        if (index < MaxRecords)
+        {
+            auto& violation = records[index];
+            violation.what = what;
+           #if SIMPLEEQ_RT_CHECK_POSIX
+            violation.numFrames = backtrace(violation.frames, MaxFrames);
+           #endif
+            violation.ready.store(true, std::memory_order_release);
+        }
+
+        recording = false;
+    }
+
+   #if SIMPLEEQ_RT_CHECK_POSIX
+    //backtrace() allocates the first time it's called, get that over with before any audio thread is marked
+    static const int backtraceWarmedUp = []
+    {
+        void* frames[1];
+        return backtrace(frames, 1);
+    }();
+   #endif
+
+    ScopedAudioThread::ScopedAudioThread() { ++audioThreadDepth; }
+    ScopedAudioThread::~ScopedAudioThread() { --audioThreadDepth; }
+
+    int getNumViolations()
+    {
+        return numViolations.load();
+    }
+
+    juce::String getReport()
+    {
+        juce::String report;
+        const auto total = getNumViolations();
+
+        for (int i = 0; i < juce::jmin(total, MaxRecords); ++i)
+        {
+            auto& violation = records[i];
+            if (!violation.ready.load(std::memory_order_acquire))
+                continue;
+
+            report << "Real time violation " << (i + 1) << ": " << violation.what << " on the audio thread\n";
+
+           #if SIMPLEEQ_RT_CHECK_POSIX
+            if (auto** symbols = backtrace_symbols(violation.frames, violation.numFrames))
+            {
+                for (int f = 0; f < violation.numFrames; ++f)
+                    report << "    " << symbols[f] << "\n";
+                std::free(symbols);
+            }
+           #endif
+        }
+
+        if (total > MaxRecords)
+            report << (total - MaxRecords) << " more violations not recorded\n";
+
+        return report;
+    }
+
+    void clear()
+    {
+        for (auto& violation : records)
+            violation.ready.store(false);
+        numViolations.store(0);
+    }
+}
+
+//==============================================================================
+//malloc hooks. glibc exports its own allocator under __libc_*, so forwarding needs no dlsym (which itself
+//calls calloc) and memory from anything not hooked here, like posix_memalign, goes back to the same heap
+#if JUCE_LINUX && defined(__GLIBC__)
+
+extern "C" void* __libc_malloc(std::size_t);
+extern "C" void* __libc_calloc(std::size_t, std::size_t);
+extern "C" void* __libc_realloc(void*, std::size_t);
+extern "C" void __libc_free(void*);
+
+extern "C" void* malloc(std::size_t size)
+{
+    if (RealtimeCheck::isViolation())
+        RealtimeCheck::record("malloc");
+
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size)
+{
+    if (RealtimeCheck::isViolation())
+        RealtimeCheck::record("calloc");
+
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, std::size_t size)
+{
+    if (RealtimeCheck::isViolation())
+        RealtimeCheck::record("realloc");
+
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void* p)
+{
+    if (p != nullptr && RealtimeCheck::isViolation())
+        RealtimeCheck::record("free");
+
+    __libc_free(p);
+}
+
+//The operator new hooks below go straight to the allocator, so one allocation isn't reported twice
+static void* uncheckedAllocate(std::size_t size) { return __libc_malloc(size); }
+static void uncheckedFree(void* p) { __libc_free(p); }
+#else
+
+static void* uncheckedAllocate(std::size_t size) { return std::malloc(size); }
+static void uncheckedFree(void* p) { std::free(p); }
+#endif
+
+//==============================================================================
+//Global allocation hooks
+static void* checkedAllocate(std::size_t size)
+{
+    if (RealtimeCheck::isViolation())
+        RealtimeCheck::record("operator new");
+
+    if (auto* p = uncheckedAllocate(size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+static void checkedFree(void* p) noexcept
+{
+    if (p != nullptr && RealtimeCheck::isViolation())
+        RealtimeCheck::record("operator delete");
+
+    uncheckedFree(p);
+}
+
+#if SIMPLEEQ_RT_CHECK_POSIX
+static void* checkedAllocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    if (RealtimeCheck::isViolation())
+        RealtimeCheck::record("operator new");
+
+    void* p = nullptr;
+    if (posix_memalign(&p, juce::jmax((std::size_t)alignment, sizeof(void*)), size == 0 ? 1 : size) == 0)
+        return p; //Released with free() like the rest
+
+    throw std::bad_alloc();
+}
+#endif
+
+void* operator new(std::size_t size)                                            { return checkedAllocate(size); }
+void* operator new[](std::size_t size)                                          { return checkedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept            { try { return checkedAllocate(size); } catch (...) { return nullptr; } }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept          { try { return checkedAllocate(size); } catch (...) { return nullptr; } }
+void operator delete(void* p) noexcept                                          { checkedFree(p); }
+void operator delete[](void* p) noexcept                                        { checkedFree(p); }
+void operator delete(void* p, std::size_t) noexcept                             { checkedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept                           { checkedFree(p); }
+
+#if SIMPLEEQ_RT_CHECK_POSIX //Elsewhere the aligned forms are left to the runtime, they come as a set
+void* operator new(std::size_t size, std::align_val_t alignment)                { return checkedAllocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment)              { return checkedAllocateAligned(size, alignment); }
+void operator delete(void* p, std::align_val_t) noexcept                        { checkedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept                      { checkedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept           { checkedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept         { checkedFree(p); }
+#endif
+
+//==============================================================================
+//Lock hooks, forwarded to the real functions
+#if SIMPLEEQ_RT_CHECK_POSIX
+using MutexLockFunction = int (*)(pthread_mutex_t*);
+using CondWaitFunction = int (*)(pthread_cond_t*, pthread_mutex_t*);
+
+//glibc keeps the pre 2.3.2 condition variable, with a different struct layout, under the same name for old
+//binaries, and a plain dlsym can hand that one back. Ask for the current version by name, where there is one
+static CondWaitFunction resolveCondWait()
+{
+   #if JUCE_LINUX && defined(__GLIBC__)
+    if (auto* function = dlvsym(RTLD_NEXT, "pthread_cond_wait", "GLIBC_2.3.2"))
+        return (CondWaitFunction)function;
+   #endif
+    return (CondWaitFunction)dlsym(RTLD_NEXT, "pthread_cond_wait"); //Platforms with only one version
+}
+
+//Resolved at load time. If something locks before that, it's resolved there and then
+static MutexLockFunction realMutexLock = (MutexLockFunction)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+static CondWaitFunction realCondWait = resolveCondWait();
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    if (RealtimeCheck::isViolation())
+        RealtimeCheck::record("pthread_mutex_lock");
+
+    if (realMutexLock == nullptr)
+        realMutexLock = (MutexLockFunction)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+
+    return realMutexLock(mutex);
+}
+
+extern "C" int pthread_cond_wait(pthread_cond_t* condition, pthread_mutex_t* mutex)
+{
+    if (RealtimeCheck::isViolation())
+        RealtimeCheck::record("pthread_cond_wait");
+
+    if (realCondWait == nullptr)
+        realCondWait = resolveCondWait();
+
+    return realCondWait(condition, mutex);
+}
+#endif
+
+#endif
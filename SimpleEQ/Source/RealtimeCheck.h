@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+    Real time safety checker for the audio thread.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+
+//Off unless the build asks for it with SIMPLEEQ_RT_CHECKS=1 (the tools do). It replaces the global
+//allocation functions, which nobody wants by surprise in a debug build of the plugin
+#ifndef SIMPLEEQ_RT_CHECKS
+ #define SIMPLEEQ_RT_CHECKS 0
+#endif
+
+/*
+While a ScopedAudioThread is alive on a thread, every global operator new / delete, on Linux with glibc every
+malloc / calloc / realloc / free (what HeapBlock and most C code use), and on Linux and macOS every
+pthread_mutex_lock / pthread_cond_wait on that thread is recorded as a violation, with a stack trace.
+
+Recording doesn't allocate or lock: the first MaxRecords violations go into a fixed table,
+the rest are only counted. getReport() turns them into text, call it from any other thread.
+
+The malloc and lock hooks interpose the C functions by symbol, so they see everything when the code is linked
+into an executable (the tools). Inside a plugin loaded by a host they usually see nothing, the operator new
+hooks always work.
+*/
+namespace RealtimeCheck
+{
+    static constexpr int MaxRecords = 32;
+    static constexpr int MaxFrames = 24;
+
+   #if SIMPLEEQ_RT_CHECKS
+    struct ScopedAudioThread //Put at the top of processBlock
+    {
+        ScopedAudioThread();
+        ~ScopedAudioThread();
+    };
+
+    int getNumViolations();
+    juce::String getReport(); //Every recorded violation with its stack trace
+    void clear();
+   #else
+    struct ScopedAudioThread {};
+
+    inline int getNumViolations() { return 0; }
+    inline juce::String getReport() { return {}; }
+    inline void clear() {}
+   #endif
+}
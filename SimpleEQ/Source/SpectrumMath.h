@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+    The analyser's post FFT arithmetic: complex bins to decibels in one pass.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <cstring>
+#include <complex>
+
+/*
+FFTDataGenerator used to take the magnitude of every bin (a sqrt), divide it by numBins and then
+call Decibels::gainToDecibels (a log10) per bin, in three loops. Here the 1 / numBins is folded into
+the window, the sqrt goes away by taking 10 * log10 of the power instead of 20 * log10 of the
+magnitude, and the log10 is an approximation made of integer and float arithmetic without branches
+or calls, so the whole pass is one loop the compiler turns into SSE / NEON code. (SIMDRegister
+has no int <-> float conversions, which the approximation needs, so it is written as plain scalar
+code for the auto vectoriser rather than with SIMDRegister.)
+
+Error spec: powerToDecibels() is within MaxDecibelError of 10 * log10(power) for every normal
+float power; fftbench checks it over the whole range.
+*/
+namespace SpectrumMath
+{
+    constexpr float MaxDecibelError = 1.0e-3f;
+
+    //10 * log10(power), for a normal positive float. Splits power into 2^e * m with m in [sqrt(0.5), sqrt(2)),
+    //then ln(m) = 2 * atanh(t), t = (m - 1) / (m + 1), |t| < 0.172, for which four terms of the series are plenty
+    inline float powerToDecibels(float power)
+    {
+        juce::int32 bits;
+        std::memcpy(&bits, &power, sizeof(bits));
+
+        const auto exponent = (bits - 0x3f3504f3) >> 23; //0x3f3504f3 is sqrt(0.5)
+        bits -= exponent * (1 << 23);
+
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+
+        const auto t = (m - 1.f) / (m + 1.f);
+        const auto t2 = t * t;
+        const auto lnM = 2.f * t * (1.f + t2 * (1.f / 3.f + t2 * (1.f / 5.f + t2 * (1.f / 7.f))));
+
+        constexpr auto ln2 = 0.693147181f, decibelsPerNeper = 4.34294482f; //10 / ln(10)
+        return ((float)exponent * ln2 + lnM) * decibelsPerNeper;
+    }
+
+    /*
+    The output of FFT::performRealOnlyForwardTransform (re, im pairs) to the levels
+    Decibels::gainToDecibels(magnitude, negativeInfinity) gives, for numBins bins. Powers below the floor
+    are clamped first, so zero and denormal bins never reach the log.
+    */
+    inline void complexToDecibels(const float* complex, float* decibels, int numBins, float negativeInfinity)
+    {
+        const auto floorPower = juce::Decibels::decibelsToGain(2.f * negativeInfinity); //10^(dB / 10), the floor as a power
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const auto re = complex[2 * bin], im = complex[2 * bin + 1];
+            const auto power = juce::jmax(floorPower, re * re + im * im);
+            decibels[bin] = juce::jmax(negativeInfinity, powerToDecibels(power));
+        }
+    }
+
+    //The compact analyser frame: hundredths of a dB in an int16, so +-327 dB in steps of 0.01 dB
+    constexpr float CompactDecibelsPerStep = 0.01f;
+
+    inline void decibelsToCompact(const float* decibels, juce::int16* compact, int numBins)
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+            compact[bin] = (juce::int16)juce::roundToInt(decibels[bin] * (1.f / CompactDecibelsPerStep));
+    }
+
+    inline void compactToDecibels(const juce::int16* compact, float* decibels, int numBins)
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+            decibels[bin] = (float)compact[bin] * CompactDecibelsPerStep;
+    }
+
+    /*
+    Two real signals that went through one complex FFT, 'a' as the real parts and 'b' as the imaginary parts,
+    back to two spectra in decibels. Since both are real, with Z[k] = p + iq and Z[N - k] = r + is:
+        A[k] = (Z[k] + conj Z[N - k]) / 2,    |A[k]|^2 = ((p + r)^2 + (q - s)^2) / 4
+        B[k] = (Z[k] - conj Z[N - k]) / 2i,   |B[k]|^2 = ((p - r)^2 + (q + s)^2) / 4
+    Same levels and floor as complexToDecibels() would give for each on its own.
+    */
+    inline void pairToDecibels(const std::complex<float>* spectrum, int fftSize, float* decibelsA, float* decibelsB, float negativeInfinity)
+    {
+        const auto floorPower = juce::Decibels::decibelsToGain(2.f * negativeInfinity); //As a power, like complexToDecibels()
+
+        for (int bin = 0; bin < fftSize / 2; ++bin)
+        {
+            const auto z = spectrum[bin], mirror = spectrum[(fftSize - bin) & (fftSize - 1)];
+            const auto p = z.real(), q = z.imag(), r = mirror.real(), s = mirror.imag();
+
+            const auto powerA = juce::jmax(floorPower, 0.25f * ((p + r) * (p + r) + (q - s) * (q - s)));
+            const auto powerB = juce::jmax(floorPower, 0.25f * ((p - r) * (p - r) + (q + s) * (q + s)));
+            decibelsA[bin] = juce::jmax(negativeInfinity, powerToDecibels(powerA));
+            decibelsB[bin] = juce::jmax(negativeInfinity, powerToDecibels(powerB));
+        }
+    }
+}
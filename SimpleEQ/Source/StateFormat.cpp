@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+    Compact binary plugin state.
+  ==============================================================================
+*/
+#include "StateFormat.h"
+#include <algorithm>
+#include <cstring>
+
+StateFormat::StateFormat(juce::AudioProcessor& processor, const juce::StringArray& sessionOnlyParameterIDs)
+{
+    for (auto* param : processor.getParameters())
+    {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param))
+            entries.push_back({ hashParameterID(ranged->paramID), ranged, sessionOnlyParameterIDs.contains(ranged->paramID) });
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+
+    //Two IDs with the same hash would load into each other. Rename one of them if this fires
+    for (size_t i = 1; i < entries.size(); ++i)
+        jassert(entries[i - 1].hash != entries[i].hash);
+}
+
+juce::uint32 StateFormat::hashParameterID(const juce::String& parameterID)
+{
+    juce::uint32 hash = 2166136261u;
+    for (auto* c = parameterID.toRawUTF8(); *c != 0; ++c)
+    {
+        hash ^= (juce::uint8)*c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void writeUint32(char* dest, juce::uint32 value)
+{
+    value = juce::ByteOrder::swapIfBigEndian(value);
+    std::memcpy(dest, &value, sizeof(value));
+}
+
+char* StateFormat::writeHeader(juce::MemoryBlock& destData, int numEntries)
+{
+    destData.setSize((size_t)(HeaderSize + EntrySize * numEntries));
+    auto* dest = static_cast<char*>(destData.getData());
+
+    writeUint32(dest, Magic);
+    writeUint32(dest + 4, (juce::uint32)Version | ((juce::uint32)numEntries << 16));
+    return dest + HeaderSize;
+}
+
+char* StateFormat::writeEntry(char* dest, juce::uint32 hash, float value)
+{
+    juce::uint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    writeUint32(dest, hash);
+    writeUint32(dest + 4, bits);
+    return dest + EntrySize;
+}
+
+void StateFormat::write(juce::MemoryBlock& destData, Scope scope) const
+{
+    auto isWritten = [scope](const Entry& entry) { return scope == Scope::Session || !entry.sessionOnly; };
+    auto* dest = writeHeader(destData, (int)std::count_if(entries.begin(), entries.end(), isWritten));
+
+    for (auto& entry : entries)
+        if (isWritten(entry))
+            dest = writeEntry(dest, entry.hash, entry.parameter->convertFrom0to1(entry.parameter->getValue()));
+}
+
+juce::MemoryBlock StateFormat::makeState(const std::vector<std::pair<juce::String, float>>& values)
+{
+    juce::MemoryBlock block;
+    auto* dest = writeHeader(block, (int)values.size());
+
+    for (auto& value : values)
+        dest = writeEntry(dest, hashParameterID(value.first), value.second);
+
+    return block;
+}
+
+bool StateFormat::isCompactState(const void* data, int sizeInBytes)
+{
+    return sizeInBytes >= HeaderSize && juce::ByteOrder::littleEndianInt(data) == Magic;
+}
+
+const StateFormat::Entry* StateFormat::find(juce::uint32 hash) const
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), hash, [](const Entry& e, juce::uint32 h) { return e.hash < h; });
+    return (it != entries.end() && it->hash == hash) ? &*it : nullptr;
+}
+
+bool StateFormat::read(const void* data, int sizeInBytes, Scope scope) const
+{
+    if (!isCompactState(data, sizeInBytes))
+        return false;
+
+    auto* src = static_cast<const char*>(data);
+    auto version = juce::ByteOrder::littleEndianShort(src + 4);
+    auto numEntries = (int)juce::ByteOrder::littleEndianShort(src + 6);
+
+    if (version > Version || sizeInBytes < HeaderSize + EntrySize * numEntries)
+    {
+        jassertfalse; //Written by a newer build, or cut short
+        return false;
+    }
+
+    //Parse everything first, so a value is only applied once the whole block is known to be good
+    std::vector<float> values(entries.size());
+    std::vector<bool> found(entries.size(), false);
+    src += HeaderSize;
+
+    for (int i = 0; i < numEntries; ++i, src += EntrySize)
+    {
+        if (auto* entry = find(juce::ByteOrder::littleEndianInt(src)))
+        {
+            auto bits = juce::ByteOrder::littleEndianInt(src + 4);
+            auto index = (size_t)(entry - entries.data());
+            std::memcpy(&values[index], &bits, sizeof(bits));
+            found[index] = true;
+        }
+        //Unknown hashes belong to parameters this build doesn't have, skip them
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (scope == Scope::Snapshot && (!found[i] || entries[i].sessionOnly)) //Older slots still have the session only ones
+            continue;
+
+        auto* param = entries[i].parameter;
+        auto normalised = found[i] ? param->convertTo0to1(values[i]) : param->getDefaultValue();
+
+        if (param->getValue() != normalised) //Most of a session's instances only differ in a few parameters
+            param->setValueNotifyingHost(normalised);
+    }
+
+    return true;
+}
+
+void StateFormat::appendSlots(juce::MemoryBlock& destData, int currentProgram, int currentSlot, const juce::MemoryBlock* slots, int numSlots)
+{
+    juce::MemoryOutputStream out(destData, true);
+
+    out.writeInt((int)SlotsMagic);
+    out.writeShort((short)currentProgram);
+    out.writeByte((char)currentSlot);
+    out.writeByte((char)numSlots);
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        out.writeInt((int)slots[i].getSize());
+        out.write(slots[i].getData(), slots[i].getSize());
+    }
+}
+
+bool StateFormat::readSlots(const void* data, int sizeInBytes, int& currentProgram, int& currentSlot, juce::MemoryBlock* slots, int numSlots)
+{
+    if (!isCompactState(data, sizeInBytes))
+        return false;
+
+    auto* src = static_cast<const char*>(data);
+    auto* end = src + sizeInBytes;
+    const auto parametersSize = HeaderSize + EntrySize * (int)juce::ByteOrder::littleEndianShort(src + 6);
+
+    if (sizeInBytes - parametersSize < 8 || juce::ByteOrder::littleEndianInt(src + parametersSize) != SlotsMagic)
+        return false;
+
+    src += parametersSize;
+
+    currentProgram = (int)juce::ByteOrder::littleEndianShort(src + 4);
+    currentSlot = (int)(juce::uint8)src[6];
+    const auto numStored = (int)(juce::uint8)src[7];
+    src += 8;
+
+    for (int i = 0; i < numStored; ++i)
+    {
+        if (end - src < 4)
+            return false;
+
+        const auto size = (size_t)juce::ByteOrder::littleEndianInt(src);
+        src += 4;
+        if ((size_t)(end - src) < size)
+        {
+            jassertfalse; //Cut short
+            return false;
+        }
+
+        if (i < numSlots)
+            slots[i].replaceAll(src, size);
+        src += size;
+    }
+
+    return true;
+}
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+    Compact binary plugin state.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+/*
+Layout, all little endian:
+    uint32  Magic ("SEQB")
+    uint16  Version
+    uint16  number of parameters
+    then per parameter: uint32 FNV-1a hash of its ID, float32 value in its own range (not normalised)
+
+Parameters are matched by the hash of their ID, so adding or reordering parameters doesn't break
+older sessions, and reading is one binary search per entry instead of parsing a whole ValueTree.
+
+A session (getStateInformation) carries the processor's A/B/C/D slots after the parameters:
+    uint32  SlotsMagic ("SEQS")
+    uint16  current program
+    uint8   current slot, uint8 number of slots
+    then per slot: uint32 size and that many bytes, a parameter block of its own (0 for a slot never visited)
+read() stops at the end of the parameter block, so older builds load these sessions too. Presets have no slots.
+*/
+class StateFormat
+{
+public:
+    static constexpr juce::uint32 Magic = 0x42514553; //"SEQB" read as a little endian uint32
+    static constexpr juce::uint16 Version = 1;
+    static constexpr juce::uint32 SlotsMagic = 0x53514553; //"SEQS"
+
+    //Indexes every parameter of the processor. The session only ones are left out of Snapshots, both ways
+    StateFormat(juce::AudioProcessor& processor, const juce::StringArray& sessionOnlyParameterIDs);
+    //Builds a block from (parameter ID, value) pairs, for the factory presets. Loaded as a Snapshot, the rest keep their value
+    static juce::MemoryBlock makeState(const std::vector<std::pair<juce::String, float>>& values);
+    static bool isCompactState(const void* data, int sizeInBytes);
+
+    //What a block stands for when it's read
+    enum class Scope
+    {
+        Session, //The whole plugin (setStateInformation): parameters missing from the block go back to their default
+        Snapshot //A preset or a slot: only the parameters in the block change
+    };
+    void write(juce::MemoryBlock& destData, Scope scope) const;
+    //Message thread
+    bool read(const void* data, int sizeInBytes, Scope scope) const;
+
+    static juce::uint32 hashParameterID(const juce::String& parameterID);
+
+    //Appends the slots to a block write() just filled
+    static void appendSlots(juce::MemoryBlock& destData, int currentProgram, int currentSlot, const juce::MemoryBlock* slots, int numSlots);
+    //False when the data has none (an older session, or a preset). Slots beyond numSlots are skipped
+    static bool readSlots(const void* data, int sizeInBytes, int& currentProgram, int& currentSlot, juce::MemoryBlock* slots, int numSlots);
+
+private:
+    static constexpr int HeaderSize = 8, EntrySize = 8;
+
+    struct Entry
+    {
+        juce::uint32 hash;
+        juce::RangedAudioParameter* parameter;
+        bool sessionOnly;
+    };
+    std::vector<Entry> entries; //Sorted by hash
+
+    const Entry* find(juce::uint32 hash) const;
+    static char* writeHeader(juce::MemoryBlock& destData, int numEntries);
+    static char* writeEntry(char* dest, juce::uint32 hash, float value);
+};
@@ -0,0 +1,436 @@
+/*
+  ==============================================================================
+    analyse: offline spectrum profiles of audio files, with the analyser's
+    FFTDataGenerator.
+  ==============================================================================
+*/
+#include "Analyse.h"
+#include "../../Source/PluginEditor.h"
+#include <iostream>
+
+namespace
+{
+    constexpr float negativeInfinity = -140.f; //Lower than the editor's -48, masters have content well below that
+    constexpr float histogramTop = 20.f, histogramStep = 0.5f;
+    constexpr int histogramSize = (int)((histogramTop - negativeInfinity) / histogramStep);
+    constexpr int chunkSize = 1 << 16; //Frames read from the file at a time
+
+    struct Options
+    {
+        juce::Array<juce::File> files;
+        juce::File outputDirectory = juce::File::getCurrentWorkingDirectory();
+        FFTOrder order = FFTOrder::order2048;
+        int hop = 0; //0: half the FFT size
+        int numThreads = juce::SystemStats::getNumCpus();
+        bool binary = false, writeSeconds = true;
+        juce::Array<float> percentiles{ 10.f, 50.f, 90.f };
+
+        static Options parse(const juce::ArgumentList& args)
+        {
+            Options options;
+            if (auto v = args.getValueForOption("--out"); v.isNotEmpty())     options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(v);
+            if (auto v = args.getValueForOption("--threads"); v.isNotEmpty()) options.numThreads = v.getIntValue();
+            if (auto v = args.getValueForOption("--hop"); v.isNotEmpty())     options.hop = v.getIntValue();
+            if (auto v = args.getValueForOption("--format"); v.isNotEmpty())  options.binary = v == "bin";
+            options.writeSeconds = !args.containsOption("--no-seconds");
+
+            if (auto v = args.getValueForOption("--fft"); v.isNotEmpty())
+            {
+                switch (v.getIntValue())
+                {
+                case 2048: options.order = FFTOrder::order2048; break;
+                case 4096: options.order = FFTOrder::order4096; break;
+                case 8192: options.order = FFTOrder::order8192; break;
+                default:   juce::ConsoleApplication::fail("--fft has to be 2048, 4096 or 8192, like the analyser");
+                }
+            }
+
+            if (auto v = args.getValueForOption("--percentiles"); v.isNotEmpty())
+            {
+                options.percentiles.clear();
+                for (auto& p : juce::StringArray::fromTokens(v, ",", ""))
+                    options.percentiles.add(juce::jlimit(0.f, 100.f, p.getFloatValue()));
+            }
+
+            //Everything that isn't an option is a file or a folder to search, after the command name itself
+            for (int i = 1; i < args.size(); ++i)
+            {
+                const auto& argument = args[i];
+                if (argument.isOption())
+                    continue;
+
+                auto file = argument.resolveAsFile();
+                if (file.isDirectory())
+                    options.files.addArray(file.findChildFiles(juce::File::findFiles, true, "*.wav;*.aif;*.aiff;*.flac;*.ogg"));
+                else if (file.existsAsFile())
+                    options.files.add(file);
+                else
+                    juce::ConsoleApplication::fail("Can't find " + argument.text);
+            }
+
+            if (options.files.isEmpty())
+                juce::ConsoleApplication::fail("No audio files given");
+            if (options.numThreads < 1 || options.hop < 0 || options.hop > 8192)
+                juce::ConsoleApplication::fail("--threads has to be positive and --hop up to the FFT size");
+            if (options.outputDirectory.createDirectory().failed())
+                juce::ConsoleApplication::fail("Can't create " + options.outputDirectory.getFullPathName());
+
+            return options;
+        }
+    };
+
+    //==============================================================================
+    //Everything kept about one file while it streams through: constant size apart from the per second frames
+    class SpectrumProfile
+    {
+    public:
+        SpectrumProfile(int bins, double rate)
+            : numBins(bins), sampleRate(rate),
+              powerSum((size_t)bins, 0.0), secondSum((size_t)bins, 0.0),
+              histogram((size_t)(bins * histogramSize), 0)
+        {
+        }
+
+        //'decibels' is one FFTDataGenerator block, the frame starts at 'startSample' of the file
+        void addFrame(const float* decibels, juce::int64 startSample)
+        {
+            const auto second = (int)(startSample / (juce::int64)sampleRate);
+            if (second != currentSecond)
+                finishSecond(second);
+
+            for (int bin = 0; bin < numBins; ++bin)
+            {
+                const auto power = std::pow(10.0, decibels[bin] / 10.0); //The generator's dB are of magnitude
+                powerSum[(size_t)bin] += power;
+                secondSum[(size_t)bin] += power;
+
+                const auto cell = juce::jlimit(0, histogramSize - 1, (int)((decibels[bin] - negativeInfinity) / histogramStep));
+                ++histogram[(size_t)(bin * histogramSize + cell)];
+            }
+
+            ++numFrames;
+            ++framesThisSecond;
+        }
+
+        void finish()
+        {
+            if (framesThisSecond > 0)
+                finishSecond(currentSecond + 1);
+        }
+
+        float getAverage(int bin) const
+        {
+            return toDecibels(powerSum[(size_t)bin] / juce::jmax(1, numFrames));
+        }
+
+        float getPercentile(int bin, float percentile) const
+        {
+            const auto* cells = histogram.data() + bin * histogramSize;
+            const auto target = (juce::int64)std::ceil(percentile / 100.f * (float)numFrames);
+
+            juce::int64 count = 0;
+            for (int cell = 0; cell < histogramSize; ++cell)
+            {
+                count += cells[cell];
+                if (count >= juce::jmax((juce::int64)1, target))
+                    return negativeInfinity + ((float)cell + 0.5f) * histogramStep;
+            }
+            return negativeInfinity;
+        }
+
+        //Power relative to the whole spectrum, of the bins whose centres are within [low, high)
+        float getBandLevel(float low, float high) const
+        {
+            double band = 0.0, total = 0.0;
+            for (int bin = 1; bin < numBins; ++bin) //Not DC
+            {
+                total += powerSum[(size_t)bin];
+                const auto frequency = getFrequency(bin);
+                if (frequency >= low && frequency < high)
+                    band += powerSum[(size_t)bin];
+            }
+            return total > 0.0 ? toDecibels(band / total) : negativeInfinity;
+        }
+
+        float getFrequency(int bin) const { return (float)(bin * sampleRate / (2.0 * numBins)); }
+
+        const int numBins;
+        const double sampleRate;
+        int numFrames = 0;
+        std::vector<float> seconds; //numBins dB per second of audio
+
+    private:
+        std::vector<double> powerSum, secondSum;
+        std::vector<juce::uint32> histogram; //histogramSize cells per bin
+        int currentSecond = 0, framesThisSecond = 0;
+
+        static float toDecibels(double power)
+        {
+            return power > 0.0 ? juce::jmax(negativeInfinity, (float)(10.0 * std::log10(power))) : negativeInfinity;
+        }
+
+        void finishSecond(int next)
+        {
+            //A second without a frame of its own (a hop longer than a second) repeats the last one
+            for (; currentSecond < next; ++currentSecond)
+                for (int bin = 0; bin < numBins; ++bin)
+                    seconds.push_back(framesThisSecond > 0 ? toDecibels(secondSum[(size_t)bin] / framesThisSecond)
+                                                           : (seconds.empty() ? negativeInfinity : seconds[seconds.size() - (size_t)numBins]));
+
+            std::fill(secondSum.begin(), secondSum.end(), 0.0);
+            framesThisSecond = 0;
+        }
+    };
+
+    //==============================================================================
+    struct FileResult
+    {
+        juce::String error, summary; //One of the two
+    };
+
+    class FileAnalysis
+    {
+    public:
+        FileAnalysis(const Options& o, const juce::File& in, const juce::String& name)
+            : options(o), input(in), outputName(name)
+        {
+            generator.changeOrder(options.order);
+        }
+
+        FileResult run()
+        {
+            juce::AudioFormatManager formats; //One per job, readers aren't shared between threads
+            formats.registerBasicFormats();
+            std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+            if (reader == nullptr)
+                return { "Can't read " + input.getFullPathName(), {} };
+
+            const auto fftSize = generator.getFFTSize();
+            const auto hop = options.hop > 0 ? juce::jmin(options.hop, fftSize) : fftSize / 2;
+            const auto numChannels = (int)reader->numChannels;
+
+            SpectrumProfile profile(fftSize / 2, reader->sampleRate);
+            juce::AudioBuffer<float> chunk(numChannels, chunkSize), frame(1, fftSize);
+            std::vector<float> fftBlock, pending; //Mono samples not analysed yet
+            pending.reserve((size_t)(chunkSize + fftSize));
+            juce::int64 pendingStart = 0;
+
+            auto analyse = [&](const float* samples, juce::int64 startSample)
+            {
+                frame.copyFrom(0, 0, samples, fftSize);
+                generator.produceFFTDataForRendering(frame, negativeInfinity);
+                if (generator.getFFTData(fftBlock))
+                    profile.addFrame(fftBlock.data(), startSample);
+            };
+
+            for (juce::int64 position = 0; position < reader->lengthInSamples; position += chunkSize)
+            {
+                const auto numSamples = (int)juce::jmin((juce::int64)chunkSize, reader->lengthInSamples - position);
+                reader->read(&chunk, 0, numSamples, position, true, true);
+
+                //Mono like the analyser sees a mono signal: the average of all channels
+                const auto gain = 1.f / (float)numChannels;
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    float sum = 0.f;
+                    for (int channel = 0; channel < numChannels; ++channel)
+                        sum += chunk.getSample(channel, i);
+                    pending.push_back(sum * gain);
+                }
+
+                size_t offset = 0;
+                for (; offset + (size_t)fftSize <= pending.size(); offset += (size_t)hop)
+                    analyse(pending.data() + offset, pendingStart + (juce::int64)offset);
+
+                offset = juce::jmin(offset, pending.size());
+                pending.erase(pending.begin(), pending.begin() + (std::ptrdiff_t)offset);
+                pendingStart += (juce::int64)offset;
+            }
+
+            if (profile.numFrames == 0) //Shorter than one FFT: zero padded
+            {
+                pending.resize((size_t)fftSize, 0.f);
+                analyse(pending.data(), 0);
+            }
+            profile.finish();
+
+            if (!(options.binary ? writeBinary(profile) : writeCsv(profile)))
+                return { "Can't write the results for " + input.getFullPathName(), {} };
+
+            juce::String summary;
+            summary << input.getFullPathName().quoted() << ","
+                    << juce::String((double)reader->lengthInSamples / reader->sampleRate, 3) << ","
+                    << reader->sampleRate << "," << numChannels << "," << profile.numFrames << ","
+                    << juce::String(profile.getBandLevel(0.f, 60.f), 2) << ","
+                    << juce::String(profile.getBandLevel(16000.f, 1.0e6f), 2);
+            return { {}, summary };
+        }
+
+    private:
+        const Options& options;
+        const juce::File input;
+        const juce::String outputName;
+        FFTDataGenerator<std::vector<float>> generator;
+
+        bool writeCsv(const SpectrumProfile& profile) const
+        {
+            juce::String text;
+            text.preallocateBytes((size_t)profile.numBins * 64);
+            text << "# " << input.getFullPathName() << "\n"
+                 << "# sample rate " << profile.sampleRate << ", fft " << profile.numBins * 2 << ", frames " << profile.numFrames << "\n"
+                 << "frequency,ltas";
+            for (auto p : options.percentiles)
+                text << ",p" << p;
+            text << "\n";
+
+            for (int bin = 0; bin < profile.numBins; ++bin)
+            {
+                text << juce::String(profile.getFrequency(bin), 2) << "," << juce::String(profile.getAverage(bin), 2);
+                for (auto p : options.percentiles)
+                    text << "," << juce::String(profile.getPercentile(bin, p), 2);
+                text << "\n";
+            }
+
+            if (!options.outputDirectory.getChildFile(outputName + ".spectrum.csv").replaceWithText(text))
+                return false;
+
+            if (!options.writeSeconds)
+                return true;
+
+            //One row per second, one column per bin
+            juce::String seconds;
+            seconds.preallocateBytes(profile.seconds.size() * 8);
+            seconds << "second";
+            for (int bin = 0; bin < profile.numBins; ++bin)
+                seconds << "," << juce::String(profile.getFrequency(bin), 2);
+            seconds << "\n";
+
+            const auto numSeconds = profile.seconds.size() / (size_t)profile.numBins;
+            for (size_t second = 0; second < numSeconds; ++second)
+            {
+                seconds << (int)second;
+                for (int bin = 0; bin < profile.numBins; ++bin)
+                    seconds << "," << juce::String(profile.seconds[second * (size_t)profile.numBins + (size_t)bin], 1);
+                seconds << "\n";
+            }
+            return options.outputDirectory.getChildFile(outputName + ".seconds.csv").replaceWithText(seconds);
+        }
+
+        bool writeBinary(const SpectrumProfile& profile) const
+        {
+            const auto numSeconds = options.writeSeconds ? profile.seconds.size() / (size_t)profile.numBins : 0;
+
+            Analyse::BinaryHeader header;
+            header.numPercentiles = (juce::uint16)options.percentiles.size();
+            header.fftSize = (juce::uint32)profile.numBins * 2;
+            header.numBins = (juce::uint32)profile.numBins;
+            header.numSeconds = (juce::uint32)numSeconds;
+            header.numFrames = (juce::uint32)profile.numFrames;
+            header.sampleRate = profile.sampleRate;
+
+            juce::MemoryOutputStream out;
+            out.write(&header, sizeof(header));
+            for (auto p : options.percentiles)
+                out.write(&p, sizeof(p));
+
+            auto writeSpectrum = [&](auto valueOfBin)
+            {
+                for (int bin = 0; bin < profile.numBins; ++bin)
+                {
+                    const float value = valueOfBin(bin);
+                    out.write(&value, sizeof(value));
+                }
+            };
+
+            writeSpectrum([&](int bin) { return profile.getFrequency(bin); });
+            writeSpectrum([&](int bin) { return profile.getAverage(bin); });
+            for (auto p : options.percentiles)
+                writeSpectrum([&](int bin) { return profile.getPercentile(bin, p); });
+
+            for (size_t i = 0; i < numSeconds * (size_t)profile.numBins; ++i)
+            {
+                const auto centiDecibels = (juce::int16)juce::roundToInt(profile.seconds[i] * 100.f);
+                out.write(&centiDecibels, sizeof(centiDecibels));
+            }
+
+            return options.outputDirectory.getChildFile(outputName + ".spectrum.bin").replaceWithData(out.getData(), out.getDataSize());
+        }
+    };
+
+    //==============================================================================
+    void runAnalyse(const juce::ArgumentList& args)
+    {
+        const auto options = Options::parse(args);
+        const auto numFiles = options.files.size();
+
+        //Output names from the file names, numbered when two inputs share one
+        juce::StringArray names;
+        for (auto& file : options.files)
+        {
+            auto name = file.getFileNameWithoutExtension();
+            for (int n = 2; names.contains(name); ++n)
+                name = file.getFileNameWithoutExtension() + "-" + juce::String(n);
+            names.add(name);
+        }
+
+        std::vector<FileResult> results((size_t)numFiles);
+        std::atomic<int> numDone{ 0 };
+        const auto start = juce::Time::getHighResolutionTicks();
+        {
+            juce::ThreadPool pool(juce::jmin(options.numThreads, numFiles));
+            for (int i = 0; i < numFiles; ++i)
+            {
+                pool.addJob([&, i]
+                {
+                    FileAnalysis analysis(options, options.files[i], names[i]);
+                    results[(size_t)i] = analysis.run();
+                    ++numDone;
+                });
+            }
+
+            while (pool.getNumJobs() > 0)
+            {
+                juce::Thread::sleep(500);
+                std::cerr << "\r" << numDone.load() << " of " << numFiles << " files" << std::flush;
+            }
+            std::cerr << std::endl;
+        }
+        const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        juce::String summary("file,seconds,sample_rate,channels,frames,below_60hz_db,above_16khz_db\n");
+        int numFailed = 0;
+        for (auto& result : results)
+        {
+            if (result.error.isNotEmpty())
+            {
+                std::cerr << result.error << std::endl;
+                ++numFailed;
+            }
+            else
+            {
+                summary << result.summary << "\n";
+            }
+        }
+
+        options.outputDirectory.getChildFile("summary.csv").replaceWithText(summary);
+        std::cout << numFiles - numFailed << " files analysed in " << juce::String(seconds, 1) << " s on "
+                  << juce::jmin(options.numThreads, numFiles) << " threads, results in "
+                  << options.outputDirectory.getFullPathName() << std::endl;
+
+        if (numFailed > 0)
+            juce::ConsoleApplication::fail(juce::String(numFailed) + " files couldn't be analysed");
+    }
+}
+
+juce::ConsoleApplication::Command Analyse::getCommand()
+{
+    return { "analyse",
+             "analyse <files or folders...> [--out=folder] [--format=csv|bin] [--fft=2048] [--hop=1024] "
+             "[--percentiles=10,50,90] [--threads=n] [--no-seconds]",
+             "Writes the average, percentile and per second spectra of audio files",
+             "Folders are searched recursively for wav, aiff, flac and ogg files. Each file is mixed to mono and run\n"
+             "through the analyser's FFT in overlapping frames (--hop samples apart, half the FFT by default).\n"
+             "Writes <name>.spectrum.csv and <name>.seconds.csv, or <name>.spectrum.bin (see Analyse.h), per file\n"
+             "and summary.csv with the level below 60 Hz and above 16 kHz of every file.",
+             runAnalyse };
+}
@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+    analyse: offline spectrum profiles of audio files, with the analyser's
+    FFTDataGenerator.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+
+/*
+For auditing masters without screen grabbing the analyser. Every file is mixed to mono and streamed
+through the same FFTDataGenerator the editor uses (same window, normalisation and dB floor), in
+chunks, so a file never has to fit in memory. Per file it writes:
+
+    - the long term average spectrum (power average over every frame)
+    - percentile spectra, from a per bin histogram of the frames' levels
+    - one averaged frame per second of audio
+
+and one line per file to summary.csv, with the level below 60 Hz and above 16 kHz relative to the
+whole spectrum. Files are analysed in parallel, one per ThreadPool thread.
+
+The binary format (--format=bin, <name>.spectrum.bin), native byte order:
+
+    BinaryHeader
+    float     percentiles[numPercentiles]              e.g. 10, 50, 90
+    float     frequencies[numBins]                     Hz, centre of each bin
+    float     ltas[numBins]                            dB
+    float     percentileSpectra[numPercentiles][numBins] dB
+    int16     seconds[numSeconds][numBins]             hundredths of a dB
+*/
+namespace Analyse
+{
+    struct BinaryHeader
+    {
+        juce::uint32 magic = 0x41514553; //'SEQA'
+        juce::uint16 version = 1;
+        juce::uint16 numPercentiles = 0;
+        juce::uint32 fftSize = 0, numBins = 0, numSeconds = 0, numFrames = 0;
+        double sampleRate = 0.0;
+    };
+    static_assert(sizeof(BinaryHeader) == 32, "Readers depend on this layout");
+
+    juce::ConsoleApplication::Command getCommand();
+}
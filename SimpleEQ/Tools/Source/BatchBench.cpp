@@ -0,0 +1,230 @@
+/*
+  ==============================================================================
+    batchbench: BatchEngine against one MonoChain per stream.
+  ==============================================================================
+*/
+#include "BatchBench.h"
+#include "../../Source/BatchEngine.h"
+#include <iostream>
+
+namespace
+{
+    struct Options
+    {
+        int numStreams = 128;
+        double seconds = 10.0; //Of audio per path
+        double sampleRate = 48000.0;
+        int blockSize = 256;
+        juce::int64 seed = 1;
+
+        static Options parse(const juce::ArgumentList& args)
+        {
+            Options options;
+            if (auto v = args.getValueForOption("--streams"); v.isNotEmpty()) options.numStreams = v.getIntValue();
+            if (auto v = args.getValueForOption("--seconds"); v.isNotEmpty()) options.seconds = v.getDoubleValue();
+            if (auto v = args.getValueForOption("--rate"); v.isNotEmpty())    options.sampleRate = v.getDoubleValue();
+            if (auto v = args.getValueForOption("--block"); v.isNotEmpty())   options.blockSize = v.getIntValue();
+            if (auto v = args.getValueForOption("--seed"); v.isNotEmpty())    options.seed = v.getLargeIntValue();
+
+            if (options.numStreams < 1 || options.blockSize < 1 || options.seconds <= 0.0 || options.sampleRate < 8000.0)
+                juce::ConsoleApplication::fail("--streams, --block, --seconds and --rate have to be positive");
+
+            return options;
+        }
+    };
+
+    //What the plugin's updateFilters() does for one channel, with the plain FilterDesign calls
+    void setUpChain(MonoChain& chain, const ChainSettings& s, double sampleRate)
+    {
+        updateCutFilter(chain.get<ChainPositions::LowCut>(), makeLowCutFilter(s, sampleRate), s.lowCutSlope);
+        updateCoefficients(chain.get<ChainPositions::Peak>().coefficients, makePeakFilter(s, sampleRate));
+        updateCutFilter(chain.get<ChainPositions::HighCut>(), makeHighCutFilter(s, sampleRate), s.highCutSlope);
+
+        chain.setBypassed<ChainPositions::Peak>(isUnityGain(s.peakGainInDecibels));
+    }
+
+    struct Paths
+    {
+        std::vector<MonoChain> chains;
+        BatchEngine batch;
+
+        void processScalar(juce::AudioBuffer<float>& buffer)
+        {
+            for (int stream = 0; stream < buffer.getNumChannels(); ++stream)
+            {
+                float* channel[] = { buffer.getWritePointer(stream) };
+                juce::dsp::AudioBlock<float> block(channel, 1, (size_t)buffer.getNumSamples());
+                juce::dsp::ProcessContextReplacing<float> context(block);
+                chains[(size_t)stream].process(context);
+            }
+        }
+
+        void processBatch(juce::AudioBuffer<float>& buffer)
+        {
+            batch.process(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
+        }
+    };
+
+    //Seconds of CPU time to run 'numBlocks' blocks of the noise in 'source' through one path
+    template<typename ProcessFunction>
+    double timePath(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& work, juce::int64 numBlocks, ProcessFunction&& process)
+    {
+        juce::int64 ticks = 0;
+        for (juce::int64 i = 0; i < numBlocks; ++i)
+        {
+            for (int channel = 0; channel < source.getNumChannels(); ++channel) //Not timed
+                work.copyFrom(channel, 0, source, channel, 0, source.getNumSamples());
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            process(work);
+            ticks += juce::Time::getHighResolutionTicks() - start;
+        }
+        return juce::Time::highResolutionTicksToSeconds(ticks);
+    }
+
+    juce::String describe(const juce::String& name, double cpuSeconds, double audioSeconds, int numStreams, int blockSize, juce::int64 numBlocks)
+    {
+        const auto streamsPerCore = numStreams * audioSeconds / cpuSeconds;
+        return name + juce::String(cpuSeconds * 1.0e6 / (double)numBlocks, 1) + " us per block of " + juce::String(blockSize)
+             + ", " + juce::String(streamsPerCore, 0) + " streams per core";
+    }
+
+    /*
+    Two streams of one group toggle the same section: stream 0 runs a peak and turns it off, then stream 1 turns it
+    on. Stream 0's output has to be the same as in an engine where stream 1 never touches it, so nothing stream 0
+    left in the section's lane leaks out when the group starts running the section again.
+    */
+    float getSharedSectionToggleDifference(double sampleRate, int blockSize)
+    {
+        ChainSettings flat, boosted;
+        boosted.peakGainInDecibels = 12.f;
+        boosted.peakFreq = 1000.f;
+
+        BatchEngine toggled, untouched;
+        for (auto* engine : { &toggled, &untouched })
+            engine->prepare(sampleRate, 2, blockSize);
+
+        juce::Random random(7);
+        juce::AudioBuffer<float> toggledIO(2, blockSize), untouchedIO(2, blockSize);
+        float maxDifference = 0.f;
+
+        for (int block = 0; block < 8; ++block)
+        {
+            const auto stream0 = block < 2 ? boosted : flat;
+            toggled.setStream(0, stream0);
+            untouched.setStream(0, stream0);
+            toggled.setStream(1, block >= 4 ? boosted : flat); //On after stream 0 left the section
+
+            toggledIO.clear();
+            for (int i = 0; i < blockSize; ++i)
+                toggledIO.setSample(0, i, random.nextFloat() * 2.f - 1.f); //Stream 1 filters silence
+            untouchedIO.makeCopyOf(toggledIO, true);
+            toggled.process(toggledIO.getArrayOfWritePointers(), 2, blockSize);
+            untouched.process(untouchedIO.getArrayOfWritePointers(), 2, blockSize);
+
+            for (int i = 0; i < blockSize; ++i)
+                maxDifference = juce::jmax(maxDifference, std::abs(toggledIO.getSample(0, i) - untouchedIO.getSample(0, i)));
+        }
+        return maxDifference;
+    }
+
+    void runBatchBench(const juce::ArgumentList& args)
+    {
+        const auto options = Options::parse(args);
+        juce::Random random(options.seed);
+
+        Paths paths;
+        paths.chains.resize((size_t)options.numStreams);
+        paths.batch.prepare(options.sampleRate, options.numStreams, options.blockSize);
+
+        juce::dsp::ProcessSpec spec;
+        spec.sampleRate = options.sampleRate;
+        spec.maximumBlockSize = (juce::uint32)options.blockSize;
+        spec.numChannels = 1;
+
+        int numSections = 0;
+        for (int stream = 0; stream < options.numStreams; ++stream)
+        {
+            const auto settings = BatchBench::makeRandomSettings(random);
+            paths.chains[(size_t)stream].prepare(spec);
+            setUpChain(paths.chains[(size_t)stream], settings, options.sampleRate);
+            paths.batch.setStream(stream, settings);
+            numSections += paths.batch.getNumActiveSections(stream);
+        }
+
+        juce::AudioBuffer<float> source(options.numStreams, options.blockSize), work(options.numStreams, options.blockSize);
+        for (int channel = 0; channel < options.numStreams; ++channel)
+            for (int i = 0; i < options.blockSize; ++i)
+                source.setSample(channel, i, random.nextFloat() * 2.f - 1.f);
+
+        const auto numBlocks = juce::jmax((juce::int64)1, (juce::int64)(options.seconds * options.sampleRate / options.blockSize));
+        const auto audioSeconds = (double)(numBlocks * options.blockSize) / options.sampleRate;
+
+        std::cout << options.numStreams << " streams, " << numSections << " biquads in total, "
+                  << BatchEngine::Lanes << " streams per SIMD register, " << audioSeconds << " s of audio at "
+                  << options.sampleRate << " Hz" << std::endl;
+
+        const auto scalarSeconds = timePath(source, work, numBlocks, [&](auto& b) { paths.processScalar(b); });
+        const auto batchSeconds = timePath(source, work, numBlocks, [&](auto& b) { paths.processBatch(b); });
+
+        std::cout << describe("scalar: ", scalarSeconds, audioSeconds, options.numStreams, options.blockSize, numBlocks) << std::endl
+                  << describe("batch:  ", batchSeconds, audioSeconds, options.numStreams, options.blockSize, numBlocks) << std::endl
+                  << "speed up: " << juce::String(scalarSeconds / batchSeconds, 2) << "x" << std::endl;
+
+        //Same input from a clean state through both: they should only differ by the float rounding of the designs
+        for (auto& chain : paths.chains)
+            chain.reset();
+        paths.batch.reset();
+
+        juce::AudioBuffer<float> scalarOut(options.numStreams, options.blockSize), batchOut(options.numStreams, options.blockSize);
+        float maxDifference = 0.f;
+        for (int block = 0; block < 16; ++block)
+        {
+            for (int channel = 0; channel < options.numStreams; ++channel)
+            {
+                scalarOut.copyFrom(channel, 0, source, channel, 0, options.blockSize);
+                batchOut.copyFrom(channel, 0, source, channel, 0, options.blockSize);
+            }
+            paths.processScalar(scalarOut);
+            paths.processBatch(batchOut);
+
+            for (int channel = 0; channel < options.numStreams; ++channel)
+                for (int i = 0; i < options.blockSize; ++i)
+                    maxDifference = juce::jmax(maxDifference, std::abs(scalarOut.getSample(channel, i) - batchOut.getSample(channel, i)));
+        }
+
+        std::cout << "largest difference from the scalar path: " << juce::Decibels::toString(juce::Decibels::gainToDecibels(maxDifference)) << std::endl;
+        if (maxDifference > 1.0e-3f)
+            juce::ConsoleApplication::fail("The batch engine doesn't match the scalar path");
+
+        const auto toggleDifference = getSharedSectionToggleDifference(options.sampleRate, options.blockSize);
+        std::cout << "section toggled by another stream of the group: " << juce::Decibels::toString(juce::Decibels::gainToDecibels(toggleDifference)) << std::endl;
+        if (toggleDifference > 0.f)
+            juce::ConsoleApplication::fail("A section another stream switched on changed a stream that doesn't use it");
+    }
+}
+
+ChainSettings BatchBench::makeRandomSettings(juce::Random& random)
+{
+    ChainSettings s;
+    s.lowCutFreq = random.nextFloat() < 0.25f ? 20.f : juce::mapToLog10(random.nextFloat(), 20.f, 500.f);
+    s.highCutFreq = random.nextFloat() < 0.25f ? 20000.f : juce::mapToLog10(random.nextFloat(), 2000.f, 20000.f);
+    s.lowCutSlope = (Slope)random.nextInt(4);
+    s.highCutSlope = (Slope)random.nextInt(4);
+    s.peakFreq = juce::mapToLog10(random.nextFloat(), 20.f, 20000.f);
+    s.peakGainInDecibels = std::round((random.nextFloat() * 48.f - 24.f) * 2.f) * 0.5f;
+    s.peakQuality = 0.1f + random.nextFloat() * 9.9f;
+    return s;
+}
+
+juce::ConsoleApplication::Command BatchBench::getCommand()
+{
+    return { "batchbench",
+             "batchbench [--streams=128] [--seconds=10] [--rate=48000] [--block=256] [--seed=1]",
+             "Compares the SIMD batch engine with one MonoChain per stream",
+             "Every stream gets random cut and peak settings. Both paths filter the same noise, the report gives the\n"
+             "time per block and the number of streams one core could keep up with in real time, then checks that\n"
+             "the two paths give the same output, and that a stream isn't disturbed when another stream of its SIMD\n"
+             "group switches on a section it just left.",
+             runBatchBench };
+}
@@ -0,0 +1,22 @@
+/*
+  ==============================================================================
+    batchbench: BatchEngine against one MonoChain per stream.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+/*
+Gives every stream its own random LowCut / Peak / HighCut settings, runs the same noise through
+one MonoChain per stream (what the plugin does per channel) and through the BatchEngine, and reports
+how many streams of real time audio one core could run with each. Also checks the two agree, and that
+streams sharing a SIMD group don't disturb each other when they switch sections on and off.
+*/
+namespace BatchBench
+{
+    juce::ConsoleApplication::Command getCommand();
+
+    //Spread like real settings: some cuts off, all four slopes, boosts and cuts on the peak. daemonbench uses it too
+    ChainSettings makeRandomSettings(juce::Random& random);
+}
@@ -0,0 +1,363 @@
+/*
+  ==============================================================================
+    daemon: keeps a pool of prepared EQ chains and processes audio sent to it
+    over a Unix domain socket.
+  ==============================================================================
+*/
+#include "Daemon.h"
+#include "DaemonProtocol.h"
+#include "../../Source/BatchEngine.h"
+#include <csignal>
+#include <iostream>
+
+using namespace DaemonProtocol;
+
+namespace
+{
+    struct Options
+    {
+        juce::String socketPath = getDefaultSocketPath();
+        int poolSize = 16;
+        double sampleRate = 48000.0;
+        int maxFrames = 4096;
+        int maxChannels = 2;
+
+        static Options parse(const juce::ArgumentList& args)
+        {
+            Options options;
+            if (auto v = args.getValueForOption("--socket"); v.isNotEmpty())       options.socketPath = v;
+            if (auto v = args.getValueForOption("--pool"); v.isNotEmpty())         options.poolSize = v.getIntValue();
+            if (auto v = args.getValueForOption("--rate"); v.isNotEmpty())         options.sampleRate = v.getDoubleValue();
+            if (auto v = args.getValueForOption("--max-block"); v.isNotEmpty())    options.maxFrames = v.getIntValue();
+            if (auto v = args.getValueForOption("--max-channels"); v.isNotEmpty()) options.maxChannels = v.getIntValue();
+
+            if (options.poolSize < 1 || options.maxFrames < 1 || options.sampleRate < 8000.0
+                || !juce::isPositiveAndNotGreaterThan(options.maxChannels, UnixSocket::MaxParts))
+                juce::ConsoleApplication::fail("--pool, --rate and --max-block have to be positive, --max-channels 1 to "
+                                               + juce::String(UnixSocket::MaxParts));
+            return options;
+        }
+    };
+
+    //Prepared once when the daemon starts. A job only changes its settings and clears its state
+    struct PooledChain
+    {
+        BatchEngine engine; //One stream per channel, all with the same settings
+        int numChannels = 0;
+        bool inUse = false;
+    };
+
+    class Server
+    {
+    public:
+        explicit Server(const Options& o) : options(o), acceptor(*this)
+        {
+            for (int i = 0; i < options.poolSize; ++i)
+            {
+                auto chain = std::make_unique<PooledChain>();
+                chain->engine.prepare(options.sampleRate, options.maxChannels, options.maxFrames);
+                pool.push_back(std::move(chain));
+            }
+        }
+
+        ~Server() { stop(); }
+
+        bool start()
+        {
+            if (!listener.listen(options.socketPath))
+                return false;
+            acceptor.startThread();
+            return true;
+        }
+
+        void stop()
+        {
+            if (!acceptor.isThreadRunning())
+                return;
+
+            acceptor.signalThreadShouldExit();
+            UnixSocket wakeUp; //accept() only returns for a connection
+            wakeUp.connect(options.socketPath);
+            acceptor.stopThread(2000);
+
+            const juce::ScopedLock sl(connectionsLock);
+            for (auto* connection : connections)
+                connection->stop();
+            connections.clear();
+        }
+
+    private:
+        //==============================================================================
+        class Connection : public juce::Thread
+        {
+        public:
+            Connection(Server& s, std::unique_ptr<UnixSocket> client)
+                : juce::Thread("daemon connection"), server(s), socket(std::move(client)),
+                  audio(s.options.maxChannels, s.options.maxFrames)
+            {
+            }
+
+            ~Connection() override { stop(); }
+
+            void stop()
+            {
+                signalThreadShouldExit();
+                socket->shutdown(); //Unblocks the read in run()
+                stopThread(2000);
+            }
+
+            void run() override
+            {
+                while (!threadShouldExit() && serveRequest())
+                {
+                }
+
+                for (auto chain : owned) //A job that disconnects without releasing still gives its chains back
+                    server.release(chain);
+            }
+
+        private:
+            Server& server;
+            std::unique_ptr<UnixSocket> socket;
+            juce::AudioBuffer<float> audio; //Process payloads are read into this, filtered here and sent back from here
+            juce::Array<int> owned;
+
+            bool reply(MessageType type, juce::uint32 chain = 0, const void* payload = nullptr, juce::uint32 payloadBytes = 0)
+            {
+                Header header;
+                header.type = type;
+                header.chain = chain;
+                header.payloadBytes = payloadBytes;
+                return socket->writeMessage(header, &payload, payload != nullptr ? 1 : 0);
+            }
+
+            bool replyError(const juce::String& message)
+            {
+                auto* text = message.toRawUTF8();
+                return reply(Error, 0, text, (juce::uint32)std::strlen(text));
+            }
+
+            //The payload of a request that was refused, so the next header is read from the right place
+            bool readSettings(const Header& header, ChainSettings& settings)
+            {
+                WireSettings wire;
+                if (header.payloadBytes != sizeof(wire))
+                    return false;
+                if (!socket->read(&wire, sizeof(wire)))
+                    return false;
+                settings = wire.toChainSettings();
+                return true;
+            }
+
+            PooledChain* getOwnedChain(juce::uint32 chain)
+            {
+                return owned.contains((int)chain) ? server.pool[(size_t)chain].get() : nullptr;
+            }
+
+            static void applySettings(PooledChain& chain, const ChainSettings& settings)
+            {
+                for (int c = 0; c < chain.engine.getMaxStreams(); ++c)
+                    chain.engine.setStream(c, settings);
+            }
+
+            //false closes the connection: the client went away or the stream can't be trusted any more
+            bool serveRequest()
+            {
+                Header header;
+                if (!socket->read(&header, sizeof(header)))
+                    return false;
+                if (header.magic != Magic)
+                    return replyError("Not a SimpleEQ daemon message") && false;
+
+                switch (header.type)
+                {
+                case Acquire:
+                {
+                    ChainSettings settings;
+                    if (!readSettings(header, settings))
+                        return replyError("Malformed Acquire") && false;
+                    if (!juce::isPositiveAndNotGreaterThan((int)header.numChannels, server.options.maxChannels))
+                        return replyError("The daemon runs at most " + juce::String(server.options.maxChannels) + " channels per chain");
+
+                    auto chain = server.acquire();
+                    if (chain < 0)
+                        return replyError("All " + juce::String(server.options.poolSize) + " chains are in use");
+
+                    auto& pooled = *server.pool[(size_t)chain];
+                    pooled.numChannels = header.numChannels;
+                    applySettings(pooled, settings);
+                    pooled.engine.reset();
+                    owned.add(chain);
+
+                    ChainInfo info;
+                    info.sampleRate = server.options.sampleRate;
+                    info.maxFrames = (juce::uint32)server.options.maxFrames;
+                    info.maxChannels = (juce::uint32)server.options.maxChannels;
+                    return reply(Acquired, (juce::uint32)chain, &info, sizeof(info));
+                }
+                case Settings:
+                {
+                    ChainSettings settings;
+                    if (!readSettings(header, settings))
+                        return replyError("Malformed Settings") && false;
+                    auto* pooled = getOwnedChain(header.chain);
+                    if (pooled == nullptr)
+                        return replyError("Chain " + juce::String(header.chain) + " isn't acquired by this connection");
+
+                    applySettings(*pooled, settings);
+                    return reply(Ok, header.chain);
+                }
+                case Process:
+                {
+                    auto* pooled = getOwnedChain(header.chain);
+
+                    //The client's counts are checked as they came, unsigned, and the payload size is worked out in size_t,
+                    //so no value can wrap around into something that passes
+                    if (pooled == nullptr || (juce::uint32)header.numChannels != (juce::uint32)pooled->numChannels
+                        || header.numFrames > (juce::uint32)server.options.maxFrames
+                        || (size_t)header.payloadBytes != (size_t)header.numChannels * (size_t)header.numFrames * sizeof(float))
+                    {
+                        if (!socket->skip(header.payloadBytes))
+                            return false;
+                        return replyError("Process: unknown chain, wrong channel count or more than "
+                                          + juce::String(server.options.maxFrames) + " frames");
+                    }
+
+                    const auto numChannels = (int)header.numChannels, numFrames = (int)header.numFrames; //Both in range now
+                    for (int c = 0; c < numChannels; ++c)
+                        if (!socket->read(audio.getWritePointer(c), (size_t)numFrames * sizeof(float)))
+                            return false;
+
+                    pooled->engine.process(audio.getArrayOfWritePointers(), numChannels, numFrames);
+
+                    std::array<const void*, UnixSocket::MaxParts> parts;
+                    for (int c = 0; c < numChannels; ++c)
+                        parts[(size_t)c] = audio.getReadPointer(c);
+
+                    header.type = Processed;
+                    return socket->writeMessage(header, parts.data(), numChannels);
+                }
+                case Reset:
+                case Release:
+                {
+                    auto* pooled = getOwnedChain(header.chain);
+                    if (!socket->skip(header.payloadBytes))
+                        return false;
+                    if (pooled == nullptr)
+                        return replyError("Chain " + juce::String(header.chain) + " isn't acquired by this connection");
+
+                    if (header.type == Reset)
+                    {
+                        pooled->engine.reset();
+                    }
+                    else
+                    {
+                        owned.removeFirstMatchingValue((int)header.chain);
+                        server.release((int)header.chain);
+                    }
+                    return reply(Ok, header.chain);
+                }
+                default:
+                    return replyError("Unknown message type " + juce::String(header.type)) && false;
+                }
+            }
+        };
+
+        //==============================================================================
+        struct Acceptor : public juce::Thread
+        {
+            explicit Acceptor(Server& s) : juce::Thread("daemon acceptor"), server(s) {}
+
+            void run() override
+            {
+                while (!threadShouldExit())
+                {
+                    auto client = server.listener.accept();
+                    if (client == nullptr || threadShouldExit())
+                        break;
+                    server.addConnection(std::move(client));
+                }
+            }
+
+            Server& server;
+        };
+
+        const Options options;
+        UnixSocket listener;
+        Acceptor acceptor;
+        std::vector<std::unique_ptr<PooledChain>> pool;
+        juce::CriticalSection poolLock;
+        juce::OwnedArray<Connection> connections;
+        juce::CriticalSection connectionsLock;
+
+        int acquire()
+        {
+            const juce::ScopedLock sl(poolLock);
+            for (size_t i = 0; i < pool.size(); ++i)
+            {
+                if (!pool[i]->inUse)
+                {
+                    pool[i]->inUse = true;
+                    return (int)i;
+                }
+            }
+            return -1;
+        }
+
+        void release(int chain)
+        {
+            const juce::ScopedLock sl(poolLock);
+            pool[(size_t)chain]->inUse = false;
+        }
+
+        void addConnection(std::unique_ptr<UnixSocket> client)
+        {
+            const juce::ScopedLock sl(connectionsLock);
+
+            for (int i = connections.size(); --i >= 0;) //Jobs that already disconnected
+                if (!connections[i]->isThreadRunning())
+                    connections.remove(i);
+
+            auto* connection = connections.add(new Connection(*this, std::move(client)));
+            connection->startThread(juce::Thread::realtimeAudioPriority);
+        }
+    };
+
+    std::atomic<bool> stopRequested{ false };
+
+    void runDaemon(const juce::ArgumentList& args)
+    {
+        if (!UnixSocket::isSupported())
+            juce::ConsoleApplication::fail("The daemon needs Unix domain sockets (Linux or macOS)");
+
+        const auto options = Options::parse(args);
+        Server server(options);
+
+        if (!server.start())
+            juce::ConsoleApplication::fail("Can't listen on " + options.socketPath);
+
+        std::cout << "Listening on " << options.socketPath << ": " << options.poolSize << " chains of up to "
+                  << options.maxChannels << " channels at " << options.sampleRate << " Hz, blocks of up to "
+                  << options.maxFrames << " frames. Ctrl+C to stop" << std::endl;
+
+        std::signal(SIGINT, [](int) { stopRequested = true; });
+        std::signal(SIGTERM, [](int) { stopRequested = true; });
+
+        while (!stopRequested)
+            juce::Thread::sleep(100);
+
+        server.stop();
+        std::cout << "Stopped" << std::endl;
+    }
+}
+
+juce::ConsoleApplication::Command Daemon::getCommand()
+{
+    return { "daemon",
+             "daemon [--socket=path] [--pool=16] [--rate=48000] [--max-block=4096] [--max-channels=2]",
+             "Serves a pool of prepared EQ chains over a Unix domain socket",
+             "The chains are prepared once for --rate and --max-block. Clients (daemonclient, daemonbench or your own,\n"
+             "see DaemonProtocol.h) acquire one, send their ChainSettings and stream planar float blocks through it.\n"
+             "The socket defaults to simpleeq.sock in the temporary directory.",
+             runDaemon };
+}
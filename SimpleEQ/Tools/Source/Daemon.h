@@ -0,0 +1,20 @@
+/*
+  ==============================================================================
+    daemon: keeps a pool of prepared EQ chains and processes audio sent to it
+    over a Unix domain socket.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+
+/*
+For render jobs that would otherwise load the plugin and run prepareToPlay every time. The chains
+are prepared once at start up for one sample rate and block size; a job acquires one, sets its
+ChainSettings, streams blocks through it and releases it. Every connection is served by its own thread,
+so separate jobs run in parallel. The protocol is in DaemonProtocol.h, daemonclient and daemonbench
+(DaemonBench.h) are the client side.
+*/
+namespace Daemon
+{
+    juce::ConsoleApplication::Command getCommand();
+}
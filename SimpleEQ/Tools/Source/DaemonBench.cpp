@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+    daemonbench and daemonclient: the client side of the processing daemon.
+  ==============================================================================
+*/
+#include "DaemonBench.h"
+#include "DaemonProtocol.h"
+#include "BatchBench.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+    juce::String getSocketPath(const juce::ArgumentList& args)
+    {
+        auto path = args.getValueForOption("--socket");
+        return path.isNotEmpty() ? path : DaemonProtocol::getDefaultSocketPath();
+    }
+
+    //==============================================================================
+    struct BenchOptions
+    {
+        juce::String socketPath;
+        int numClients = 1;
+        int numChannels = 2;
+        int blockSize = 256;
+        double seconds = 10.0; //Of audio per client
+        juce::int64 seed = 1;
+
+        static BenchOptions parse(const juce::ArgumentList& args)
+        {
+            BenchOptions options;
+            options.socketPath = getSocketPath(args);
+            if (auto v = args.getValueForOption("--clients"); v.isNotEmpty())  options.numClients = v.getIntValue();
+            if (auto v = args.getValueForOption("--channels"); v.isNotEmpty()) options.numChannels = v.getIntValue();
+            if (auto v = args.getValueForOption("--block"); v.isNotEmpty())    options.blockSize = v.getIntValue();
+            if (auto v = args.getValueForOption("--seconds"); v.isNotEmpty())  options.seconds = v.getDoubleValue();
+            if (auto v = args.getValueForOption("--seed"); v.isNotEmpty())     options.seed = v.getLargeIntValue();
+
+            if (options.numClients < 1 || options.blockSize < 1 || options.seconds <= 0.0
+                || !juce::isPositiveAndNotGreaterThan(options.numChannels, UnixSocket::MaxParts))
+                juce::ConsoleApplication::fail("--clients, --block and --seconds have to be positive, --channels 1 to "
+                                               + juce::String(UnixSocket::MaxParts));
+            return options;
+        }
+    };
+
+    //One job: acquires a chain and streams blocks through it as fast as the daemon answers
+    class BenchClient : public juce::Thread
+    {
+    public:
+        BenchClient(const BenchOptions& o, const ChainSettings& s, juce::int64 seed)
+            : juce::Thread("daemonbench client"), options(o), settings(s),
+              source(o.numChannels, o.blockSize), work(o.numChannels, o.blockSize)
+        {
+            juce::Random random(seed);
+            for (int channel = 0; channel < options.numChannels; ++channel)
+                for (int i = 0; i < options.blockSize; ++i)
+                    source.setSample(channel, i, random.nextFloat() * 2.f - 1.f);
+        }
+
+        void run() override
+        {
+            if (!client.connect(options.socketPath))
+                return;
+
+            const auto acquireStart = juce::Time::getHighResolutionTicks();
+            chain = client.acquire(options.numChannels, settings);
+            acquireSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - acquireStart);
+            if (chain < 0)
+                return;
+
+            sampleRate = client.getChainInfo().sampleRate;
+            const auto numBlocks = juce::jmax(1, (int)(options.seconds * sampleRate / options.blockSize));
+            latencies.reserve((size_t)numBlocks);
+
+            for (int block = 0; block < numBlocks && !threadShouldExit(); ++block)
+            {
+                for (int channel = 0; channel < options.numChannels; ++channel)
+                    work.copyFrom(channel, 0, source, channel, 0, options.blockSize);
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                if (!client.process(chain, work.getArrayOfWritePointers(), options.numChannels, options.blockSize))
+                    return;
+                latencies.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+            }
+
+            client.release(chain);
+        }
+
+        bool succeeded() const { return chain >= 0 && !latencies.empty() && client.getLastError().isEmpty(); }
+        const juce::String& getError() const { return client.getLastError(); }
+
+        const BenchOptions& options;
+        const ChainSettings settings;
+        DaemonClient client;
+        juce::AudioBuffer<float> source, work;
+        int chain = -1;
+        double sampleRate = 0.0, acquireSeconds = 0.0;
+        std::vector<double> latencies; //Round trip per block, seconds
+    };
+
+    double getPercentile(const std::vector<double>& sorted, double fraction)
+    {
+        return sorted[juce::jmin(sorted.size() - 1, (size_t)(fraction * (double)sorted.size()))];
+    }
+
+    juce::String toMicroseconds(double seconds)
+    {
+        return juce::String(seconds * 1.0e6, 1) + " us";
+    }
+
+    //What a render job pays per run without the daemon
+    double timeColdStart(double sampleRate, int blockSize)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        {
+            SimpleEQAudioProcessor processor;
+            processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor.prepareToPlay(sampleRate, blockSize);
+            processor.releaseResources();
+        }
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    }
+
+    void runDaemonBench(const juce::ArgumentList& args)
+    {
+        const auto options = BenchOptions::parse(args);
+
+        juce::Random random(options.seed);
+        juce::OwnedArray<BenchClient> clients;
+        for (int i = 0; i < options.numClients; ++i)
+            clients.add(new BenchClient(options, BatchBench::makeRandomSettings(random), random.nextInt64()));
+
+        const auto wallStart = juce::Time::getHighResolutionTicks();
+        for (auto* client : clients)
+            client->startThread();
+        for (auto* client : clients)
+            client->waitForThreadToExit(-1);
+        const auto wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - wallStart);
+
+        std::vector<double> latencies;
+        double audioSeconds = 0.0, slowestAcquire = 0.0, sampleRate = 0.0;
+        for (auto* client : clients)
+        {
+            if (!client->succeeded())
+                juce::ConsoleApplication::fail("Client failed: " + client->getError());
+
+            latencies.insert(latencies.end(), client->latencies.begin(), client->latencies.end());
+            audioSeconds += (double)(client->latencies.size() * (size_t)options.blockSize) / client->sampleRate;
+            slowestAcquire = juce::jmax(slowestAcquire, client->acquireSeconds);
+            sampleRate = client->sampleRate;
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << options.numClients << " clients, " << options.numChannels << " channels, blocks of " << options.blockSize
+                  << " at " << sampleRate << " Hz, " << latencies.size() << " blocks in total" << std::endl
+                  << "round trip per block: p50 " << toMicroseconds(getPercentile(latencies, 0.5))
+                  << ", p99 " << toMicroseconds(getPercentile(latencies, 0.99))
+                  << ", max " << toMicroseconds(latencies.back())
+                  << " (the block lasts " << toMicroseconds(options.blockSize / sampleRate) << ")" << std::endl
+                  << "throughput: " << juce::String(audioSeconds / wallSeconds, 1) << "x real time, "
+                  << juce::String(audioSeconds * sampleRate * options.numChannels / wallSeconds / 1.0e6, 2) << " M samples/s" << std::endl
+                  << "acquire (warm chain): " << toMicroseconds(slowestAcquire) << " at most" << std::endl
+                  << "new processor + prepareToPlay (cold): " << toMicroseconds(timeColdStart(sampleRate, options.blockSize)) << std::endl;
+    }
+
+    //==============================================================================
+    void runDaemonClient(const juce::ArgumentList& args)
+    {
+        auto getFloat = [&args](juce::StringRef option, float fallback)
+        {
+            auto v = args.getValueForOption(option);
+            return v.isNotEmpty() ? v.getFloatValue() : fallback;
+        };
+
+        //Slopes in dB/Oct like the plugin's choices: 12, 24, 36 or 48
+        auto getSlope = [&args](juce::StringRef option)
+        {
+            auto v = args.getValueForOption(option);
+            return v.isNotEmpty() ? (Slope)juce::jlimit(0, 3, v.getIntValue() / 12 - 1) : Slope_12;
+        };
+
+        ChainSettings settings;
+        settings.lowCutFreq = getFloat("--lowcut", 20.f);
+        settings.lowCutSlope = getSlope("--lowcut-slope");
+        settings.highCutFreq = getFloat("--highcut", 20000.f);
+        settings.highCutSlope = getSlope("--highcut-slope");
+        settings.peakFreq = getFloat("--peak-freq", 750.f);
+        settings.peakGainInDecibels = getFloat("--peak-gain", 0.f);
+        settings.peakQuality = getFloat("--peak-q", 1.f);
+
+        auto channelsOption = args.getValueForOption("--channels");
+        const auto numChannels = channelsOption.isNotEmpty() ? channelsOption.getIntValue() : 2;
+        if (!juce::isPositiveAndNotGreaterThan(numChannels, UnixSocket::MaxParts))
+            juce::ConsoleApplication::fail("--channels has to be 1 to " + juce::String(UnixSocket::MaxParts));
+
+        DaemonClient client;
+        if (!client.connect(getSocketPath(args)))
+            juce::ConsoleApplication::fail(client.getLastError());
+
+        const auto chain = client.acquire(numChannels, settings);
+        if (chain < 0)
+            juce::ConsoleApplication::fail(client.getLastError());
+
+        std::cerr << "Filtering at " << client.getChainInfo().sampleRate << " Hz" << std::endl;
+
+        const auto blockSize = (int)client.getChainInfo().maxFrames;
+        std::vector<float> interleaved((size_t)(blockSize * numChannels));
+        juce::AudioBuffer<float> planar(numChannels, blockSize);
+
+        for (;;)
+        {
+            const auto numFrames = (int)(std::fread(interleaved.data(), sizeof(float) * (size_t)numChannels, (size_t)blockSize, stdin));
+            if (numFrames == 0)
+                break;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int i = 0; i < numFrames; ++i)
+                    planar.setSample(channel, i, interleaved[(size_t)(i * numChannels + channel)]);
+
+            if (!client.process(chain, planar.getArrayOfWritePointers(), numChannels, numFrames))
+                juce::ConsoleApplication::fail(client.getLastError());
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int i = 0; i < numFrames; ++i)
+                    interleaved[(size_t)(i * numChannels + channel)] = planar.getSample(channel, i);
+
+            std::fwrite(interleaved.data(), sizeof(float) * (size_t)numChannels, (size_t)numFrames, stdout);
+        }
+
+        std::fflush(stdout);
+        client.release(chain);
+    }
+}
+
+juce::ConsoleApplication::Command DaemonBench::getBenchCommand()
+{
+    return { "daemonbench",
+             "daemonbench [--socket=path] [--clients=1] [--channels=2] [--block=256] [--seconds=10] [--seed=1]",
+             "Measures round trip latency and throughput of a running daemon",
+             "Every client acquires its own chain with random settings and sends blocks of noise as fast as the daemon\n"
+             "answers. Reports the round trip percentiles per block, how many times faster than real time the audio\n"
+             "went through, and the acquire time next to the cost of making and preparing a new processor.",
+             runDaemonBench };
+}
+
+juce::ConsoleApplication::Command DaemonBench::getClientCommand()
+{
+    return { "daemonclient",
+             "daemonclient [--socket=path] [--channels=2] [--lowcut=20] [--lowcut-slope=12] [--peak-freq=750] [--peak-gain=0] "
+             "[--peak-q=1] [--highcut=20000] [--highcut-slope=12] < in.f32 > out.f32",
+             "Filters interleaved float32 audio from stdin to stdout through the daemon",
+             "The audio has to be at the daemon's sample rate, which is printed to stderr. Slopes are in dB/Oct.\n"
+             "For example: sox in.wav -t f32 - | SimpleEQTools daemonclient --lowcut=80 | sox -t f32 -r 48000 -c 2 - out.wav",
+             runDaemonClient };
+}
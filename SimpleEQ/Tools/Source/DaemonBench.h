@@ -0,0 +1,21 @@
+/*
+  ==============================================================================
+    daemonbench and daemonclient: the client side of the processing daemon.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+
+/*
+daemonbench runs a number of clients against a running daemon, each streaming noise through its
+own chain, and reports the round trip time per block and how much faster than real time the daemon
+gets through the audio. For comparison it also times what a job pays without the daemon: making
+a SimpleEQAudioProcessor and preparing it.
+
+daemonclient filters interleaved float32 from stdin to stdout, for scripts and render jobs.
+*/
+namespace DaemonBench
+{
+    juce::ConsoleApplication::Command getBenchCommand();
+    juce::ConsoleApplication::Command getClientCommand();
+}
@@ -0,0 +1,383 @@
+/*
+  ==============================================================================
+    Wire protocol, socket and client of the processing daemon.
+  ==============================================================================
+*/
+#include "DaemonProtocol.h"
+#include <array>
+#include <cstring>
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+ #define SIMPLEEQ_UNIX_SOCKETS 1
+ #include <cerrno>
+ #include <sys/socket.h>
+ #include <sys/uio.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#else
+ #define SIMPLEEQ_UNIX_SOCKETS 0
+#endif
+
+using namespace DaemonProtocol;
+
+WireSettings WireSettings::fromChainSettings(const ChainSettings& settings)
+{
+    WireSettings wire;
+    wire.lowCutFreq = settings.lowCutFreq;
+    wire.highCutFreq = settings.highCutFreq;
+    wire.lowCutSlope = (juce::uint32)settings.lowCutSlope;
+    wire.highCutSlope = (juce::uint32)settings.highCutSlope;
+    wire.peakFreq = settings.peakFreq;
+    wire.peakGainInDecibels = settings.peakGainInDecibels;
+    wire.peakQuality = settings.peakQuality;
+    return wire;
+}
+
+ChainSettings WireSettings::toChainSettings() const
+{
+    //Clamped to the parameter ranges, the values come from another process
+    ChainSettings settings;
+    settings.lowCutFreq = juce::jlimit(20.f, 20000.f, lowCutFreq);
+    settings.highCutFreq = juce::jlimit(20.f, 20000.f, highCutFreq);
+    settings.lowCutSlope = (Slope)juce::jmin(lowCutSlope, (juce::uint32)Slope_48);
+    settings.highCutSlope = (Slope)juce::jmin(highCutSlope, (juce::uint32)Slope_48);
+    settings.peakFreq = juce::jlimit(20.f, 20000.f, peakFreq);
+    settings.peakGainInDecibels = juce::jlimit(-24.f, 24.f, peakGainInDecibels);
+    settings.peakQuality = juce::jlimit(0.1f, 10.f, peakQuality);
+    return settings;
+}
+
+juce::String DaemonProtocol::getDefaultSocketPath()
+{
+    return juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("simpleeq.sock").getFullPathName();
+}
+
+//==============================================================================
+#if SIMPLEEQ_UNIX_SOCKETS
+namespace
+{
+   #ifdef MSG_NOSIGNAL
+    constexpr int noSignal = MSG_NOSIGNAL; //A client that went away is an error return, not a SIGPIPE
+   #else
+    constexpr int noSignal = 0;            //macOS: SO_NOSIGPIPE on the socket instead
+   #endif
+
+    int openSocket()
+    {
+        auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+       #ifdef SO_NOSIGPIPE
+        if (fd >= 0)
+        {
+            int on = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+        }
+       #endif
+        return fd;
+    }
+
+    bool makeAddress(const juce::String& path, sockaddr_un& address)
+    {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+
+        auto* utf8 = path.toRawUTF8();
+        if (std::strlen(utf8) >= sizeof(address.sun_path))
+            return false;
+
+        std::strcpy(address.sun_path, utf8);
+        return true;
+    }
+}
+
+UnixSocket::~UnixSocket()
+{
+    if (fd >= 0)
+        ::close(fd);
+
+    if (boundPath.isNotEmpty())
+        ::unlink(boundPath.toRawUTF8());
+}
+
+bool UnixSocket::isSupported() { return true; }
+
+bool UnixSocket::connect(const juce::String& path)
+{
+    jassert(fd < 0);
+    sockaddr_un address;
+    if (!makeAddress(path, address) || (fd = openSocket()) < 0)
+        return false;
+
+    if (::connect(fd, (const sockaddr*)&address, sizeof(address)) == 0)
+        return true;
+
+    ::close(fd);
+    fd = -1;
+    return false;
+}
+
+bool UnixSocket::listen(const juce::String& path)
+{
+    jassert(fd < 0);
+    sockaddr_un address;
+    if (!makeAddress(path, address) || (fd = openSocket()) < 0)
+        return false;
+
+    ::unlink(address.sun_path); //Left behind by a daemon that didn't exit cleanly
+    if (::bind(fd, (const sockaddr*)&address, sizeof(address)) == 0 && ::listen(fd, 16) == 0)
+    {
+        boundPath = path;
+        return true;
+    }
+
+    ::close(fd);
+    fd = -1;
+    return false;
+}
+
+std::unique_ptr<UnixSocket> UnixSocket::accept()
+{
+    for (;;)
+    {
+        auto client = ::accept(fd, nullptr, nullptr);
+        if (client >= 0)
+            return std::unique_ptr<UnixSocket>(new UnixSocket(client));
+        if (errno != EINTR)
+            return nullptr;
+    }
+}
+
+bool UnixSocket::read(void* dest, size_t numBytes)
+{
+    auto* p = static_cast<char*>(dest);
+    while (numBytes > 0)
+    {
+        auto n = ::recv(fd, p, numBytes, 0);
+        if (n > 0)
+        {
+            p += n;
+            numBytes -= (size_t)n;
+        }
+        else if (n == 0 || errno != EINTR)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UnixSocket::writeMessage(const Header& header, const void* const* parts, int numParts)
+{
+    jassert(numParts <= MaxParts && (numParts == 0 || header.payloadBytes % (juce::uint32)numParts == 0));
+
+    std::array<iovec, MaxParts + 1> pieces;
+    int count = 0;
+    pieces[(size_t)count++] = { const_cast<Header*>(&header), sizeof(header) };
+    for (int i = 0; i < juce::jmin(numParts, MaxParts); ++i)
+        pieces[(size_t)count++] = { const_cast<void*>(parts[i]), header.payloadBytes / (size_t)numParts };
+
+    int first = 0;
+    while (first < count)
+    {
+        msghdr message{};
+        message.msg_iov = pieces.data() + first;
+        message.msg_iovlen = (decltype(message.msg_iovlen))(count - first);
+
+        auto sent = ::sendmsg(fd, &message, noSignal);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        //Skip what went out, a big block can take several calls
+        while (first < count && sent >= (ssize_t)pieces[(size_t)first].iov_len)
+            sent -= (ssize_t)pieces[(size_t)first++].iov_len;
+        if (first < count)
+        {
+            pieces[(size_t)first].iov_base = static_cast<char*>(pieces[(size_t)first].iov_base) + sent;
+            pieces[(size_t)first].iov_len -= (size_t)sent;
+        }
+    }
+    return true;
+}
+
+void UnixSocket::shutdown()
+{
+    if (fd >= 0)
+        ::shutdown(fd, SHUT_RDWR);
+}
+#else
+UnixSocket::~UnixSocket() {}
+bool UnixSocket::isSupported() { return false; }
+bool UnixSocket::connect(const juce::String&) { return false; }
+bool UnixSocket::listen(const juce::String&) { return false; }
+std::unique_ptr<UnixSocket> UnixSocket::accept() { return nullptr; }
+bool UnixSocket::read(void*, size_t) { return false; }
+bool UnixSocket::writeMessage(const Header&, const void* const*, int) { return false; }
+void UnixSocket::shutdown() {}
+#endif
+
+bool UnixSocket::skip(size_t numBytes)
+{
+    char scratch[256];
+    while (numBytes > 0)
+    {
+        auto n = juce::jmin(numBytes, sizeof(scratch));
+        if (!read(scratch, n))
+            return false;
+        numBytes -= n;
+    }
+    return true;
+}
+
+//==============================================================================
+bool DaemonClient::connect(const juce::String& socketPath)
+{
+    if (socket.connect(socketPath))
+        return true;
+
+    lastError = "Can't connect to " + socketPath + ", is the daemon running?";
+    return false;
+}
+
+bool DaemonClient::readReplyHeader(Header& reply, MessageType expected)
+{
+    if (!socket.read(&reply, sizeof(reply)) || reply.magic != Magic)
+    {
+        lastError = "Lost the connection to the daemon";
+        return false;
+    }
+
+    if (reply.type == Error)
+    {
+        //The length comes from the other end: keep the first MaxErrorBytes and drop the rest
+        char text[MaxErrorBytes];
+        const auto length = juce::jmin(reply.payloadBytes, (juce::uint32)MaxErrorBytes);
+
+        if (!socket.read(text, length) || !socket.skip(reply.payloadBytes - length))
+            lastError = "Lost the connection to the daemon";
+        else
+            lastError = juce::String::fromUTF8(text, (int)length);
+        return false;
+    }
+
+    if (reply.type != expected)
+    {
+        lastError = "Unexpected reply from the daemon";
+        return false;
+    }
+    return true;
+}
+
+bool DaemonClient::readReply(Header& reply, MessageType expected, void* payload, size_t payloadCapacity)
+{
+    if (!readReplyHeader(reply, expected))
+        return false;
+
+    if (reply.payloadBytes > payloadCapacity)
+    {
+        lastError = "Unexpected reply from the daemon";
+        return false;
+    }
+    return reply.payloadBytes == 0 || socket.read(payload, reply.payloadBytes);
+}
+
+bool DaemonClient::request(Header header, const void* payload, MessageType expectedReply)
+{
+    Header reply;
+    if (!socket.writeMessage(header, &payload, payload != nullptr ? 1 : 0))
+    {
+        lastError = "Lost the connection to the daemon";
+        return false;
+    }
+    return readReply(reply, expectedReply, nullptr, 0);
+}
+
+int DaemonClient::acquire(int numChannels, const ChainSettings& settings)
+{
+    Header header;
+    header.type = Acquire;
+    header.numChannels = (juce::uint16)numChannels;
+    header.payloadBytes = sizeof(WireSettings);
+
+    const auto wire = WireSettings::fromChainSettings(settings);
+    const void* payload = &wire;
+
+    Header reply;
+    if (!socket.writeMessage(header, &payload, 1) || !readReply(reply, Acquired, &info, sizeof(info)))
+        return -1;
+
+    return (int)reply.chain;
+}
+
+bool DaemonClient::setSettings(int chain, const ChainSettings& settings)
+{
+    Header header;
+    header.type = Settings;
+    header.chain = (juce::uint32)chain;
+    header.payloadBytes = sizeof(WireSettings);
+
+    const auto wire = WireSettings::fromChainSettings(settings);
+    return request(header, &wire, Ok);
+}
+
+bool DaemonClient::process(int chain, float* const* channels, int numChannels, int numFrames)
+{
+    if (info.maxFrames == 0 || !juce::isPositiveAndNotGreaterThan(numChannels, UnixSocket::MaxParts))
+    {
+        lastError = "Process: no chain info, or not 1 to " + juce::String(UnixSocket::MaxParts) + " channels";
+        return false;
+    }
+
+    for (int start = 0; start < numFrames; start += (int)info.maxFrames)
+    {
+        const auto num = juce::jmin((int)info.maxFrames, numFrames - start);
+
+        std::array<const void*, UnixSocket::MaxParts> parts;
+        for (int c = 0; c < numChannels; ++c)
+            parts[(size_t)c] = channels[c] + start;
+
+        Header header;
+        header.type = Process;
+        header.numChannels = (juce::uint16)numChannels;
+        header.chain = (juce::uint32)chain;
+        header.numFrames = (juce::uint32)num;
+        header.payloadBytes = (juce::uint32)(num * numChannels * (int)sizeof(float));
+
+        Header reply;
+        if (!socket.writeMessage(header, parts.data(), numChannels))
+        {
+            lastError = "Lost the connection to the daemon";
+            return false;
+        }
+        if (!readReplyHeader(reply, Processed))
+            return false;
+        if (reply.numFrames != header.numFrames || reply.payloadBytes != header.payloadBytes)
+        {
+            lastError = "Unexpected reply from the daemon";
+            return false;
+        }
+
+        for (int c = 0; c < numChannels; ++c) //Straight back into the caller's channels
+            if (!socket.read(channels[c] + start, (size_t)num * sizeof(float)))
+                return false;
+    }
+    return true;
+}
+
+bool DaemonClient::reset(int chain)
+{
+    Header header;
+    header.type = Reset;
+    header.chain = (juce::uint32)chain;
+    return request(header, nullptr, Ok);
+}
+
+bool DaemonClient::release(int chain)
+{
+    Header header;
+    header.type = Release;
+    header.chain = (juce::uint32)chain;
+    return request(header, nullptr, Ok);
+}
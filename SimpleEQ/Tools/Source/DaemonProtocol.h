@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+    Wire protocol, socket and client of the processing daemon.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+#include <memory>
+#include "../../Source/PluginProcessor.h"
+
+/*
+Every message is a Header, followed by header.payloadBytes of payload. Both ends are on the same
+machine, so everything is in native byte order and audio is plain float32.
+
+    client                      daemon
+    Acquire  (WireSettings) ->  <- Acquired (ChainInfo), header.chain is the id to use from now on
+    Settings (WireSettings) ->  <- Ok
+    Process  (audio)        ->  <- Processed (audio)   planar: numChannels runs of numFrames floats
+    Reset                   ->  <- Ok
+    Release                 ->  <- Ok
+                                <- Error (UTF-8 text) instead of any of the replies above
+
+A Process block is at most ChainInfo::maxFrames long; DaemonClient::process() splits longer ones.
+The daemon reads a Process payload straight into the chain's buffer, filters it there and sends
+it back from the same memory: the audio is only copied by the socket itself.
+*/
+namespace DaemonProtocol
+{
+    constexpr juce::uint32 Magic = 0x44514553; //'SEQD'
+
+    enum MessageType : juce::uint16
+    {
+        Acquire = 1,
+        Acquired,
+        Settings,
+        Ok,
+        Process,
+        Processed,
+        Reset,
+        Release,
+        Error
+    };
+
+    struct Header
+    {
+        juce::uint32 magic = Magic;
+        juce::uint16 type = 0;
+        juce::uint16 numChannels = 0;  //Acquire, Process, Processed
+        juce::uint32 chain = 0;
+        juce::uint32 numFrames = 0;    //Process, Processed
+        juce::uint32 payloadBytes = 0;
+    };
+    static_assert(sizeof(Header) == 20, "Header has to be packed the same way on both ends");
+
+    struct WireSettings //ChainSettings without the dynamic Peak, which the daemon's chains don't have
+    {
+        float lowCutFreq = 20.f, highCutFreq = 20000.f;
+        juce::uint32 lowCutSlope = 0, highCutSlope = 0;
+        float peakFreq = 750.f, peakGainInDecibels = 0.f, peakQuality = 1.f;
+
+        static WireSettings fromChainSettings(const ChainSettings& settings);
+        ChainSettings toChainSettings() const;
+    };
+
+    struct ChainInfo
+    {
+        double sampleRate = 0.0;
+        juce::uint32 maxFrames = 0, maxChannels = 0;
+    };
+
+    juce::String getDefaultSocketPath();
+}
+
+//==============================================================================
+//Blocking Unix domain stream socket. Only on Linux and macOS, isSupported() is false elsewhere
+class UnixSocket
+{
+public:
+    UnixSocket() = default;
+    ~UnixSocket();
+
+    static bool isSupported();
+
+    bool connect(const juce::String& path);
+    bool listen(const juce::String& path); //Replaces a stale socket file
+    std::unique_ptr<UnixSocket> accept(); //Blocks until a client connects, nullptr on error
+
+    bool read(void* dest, size_t numBytes); //All of it, false on error or end of stream
+    bool skip(size_t numBytes);             //Reads and drops a payload that isn't wanted, same result as read()
+
+    //The header and its payload in one gathered write. The payload can be split in 'numParts' equal parts
+    //(the channels of a block, which don't have to be next to each other in memory)
+    static constexpr int MaxParts = 16;
+    bool writeMessage(const DaemonProtocol::Header& header, const void* const* parts = nullptr, int numParts = 0);
+
+    void shutdown(); //Wakes up a thread blocked in read(). The destructor closes the socket
+    bool isOpen() const { return fd >= 0; }
+
+private:
+    explicit UnixSocket(int descriptor) : fd(descriptor) {}
+    int fd = -1;
+    juce::String boundPath;
+
+    JUCE_DECLARE_NON_COPYABLE(UnixSocket)
+};
+
+//==============================================================================
+//Synchronous client: every call sends one request and waits for its reply
+class DaemonClient
+{
+public:
+    bool connect(const juce::String& socketPath);
+
+    int acquire(int numChannels, const ChainSettings& settings); //Chain id, or -1
+    bool setSettings(int chain, const ChainSettings& settings);
+    bool process(int chain, float* const* channels, int numChannels, int numFrames); //In place, any length
+    bool reset(int chain);
+    bool release(int chain);
+
+    const DaemonProtocol::ChainInfo& getChainInfo() const { return info; } //Valid after acquire()
+    const juce::String& getLastError() const { return lastError; }
+
+private:
+    UnixSocket socket;
+    DaemonProtocol::ChainInfo info;
+    juce::String lastError;
+    static constexpr int MaxErrorBytes = 4096; //Of an Error reply's text, the rest is skipped
+
+    bool request(DaemonProtocol::Header header, const void* payload, DaemonProtocol::MessageType expectedReply);
+    bool readReplyHeader(DaemonProtocol::Header& reply, DaemonProtocol::MessageType expected); //The payload is left to the caller
+    bool readReply(DaemonProtocol::Header& reply, DaemonProtocol::MessageType expected, void* payload, size_t payloadCapacity);
+};
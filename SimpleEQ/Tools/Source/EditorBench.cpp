@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+    editorbench: how long the editor takes to open, measured headlessly.
+  ==============================================================================
+*/
+#include "EditorBench.h"
+#include "../../Source/PluginEditor.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    struct Options
+    {
+        int numRuns = 20;
+        double maxOpenMs = 250.0; //Median, construction and first paint together
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+
+        static Options parse(const juce::ArgumentList& args)
+        {
+            Options options;
+            auto get = [&](juce::StringRef option) { return args.getValueForOption(option); };
+
+            if (auto v = get("--runs"); v.isNotEmpty())   options.numRuns = v.getIntValue();
+            if (auto v = get("--max-ms"); v.isNotEmpty()) options.maxOpenMs = v.getDoubleValue();
+
+            if (options.numRuns < 1 || options.maxOpenMs <= 0.0)
+                juce::ConsoleApplication::fail("--runs and --max-ms have to be positive");
+
+            return options;
+        }
+    };
+
+    struct Run
+    {
+        double constructionMs = 0.0, firstPaintMs = 0.0, analyserMs = -1.0;
+        bool analyserWasLazy = true, editorWasPainted = true;
+
+        double getOpenMs() const { return constructionMs + firstPaintMs; }
+    };
+
+    double nowMs() { return juce::Time::getMillisecondCounterHiRes(); }
+
+    Run openEditor(SimpleEQAudioProcessor& processor)
+    {
+        Run run;
+
+        auto start = nowMs();
+        std::unique_ptr<juce::AudioProcessorEditor> editor(processor.createEditorIfNeeded());
+        run.constructionMs = nowMs() - start;
+
+        auto* eqEditor = dynamic_cast<SimpleEQAudioProcessorEditor*>(editor.get());
+        if (eqEditor == nullptr)
+            juce::ConsoleApplication::fail("createEditor() didn't make a SimpleEQAudioProcessorEditor");
+
+        //The window's first frame, children included, into an Image instead of a peer
+        juce::Image frame(juce::Image::ARGB, editor->getWidth(), editor->getHeight(), true);
+        start = nowMs();
+        {
+            juce::Graphics g(frame);
+            editor->paintEntireComponent(g, true);
+        }
+        run.firstPaintMs = nowMs() - start;
+
+        auto timings = eqEditor->getOpenTimings();
+        run.editorWasPainted = timings.firstPaintMs >= 0.0;
+        run.analyserWasLazy = timings.analyserCreationMs < 0.0; //Nothing has ticked yet
+
+        //Let the curve's timer tick until the analyser is there, a second at most
+        for (auto deadline = nowMs() + 1000.0; timings.analyserCreationMs < 0.0 && nowMs() < deadline;)
+        {
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(5);
+            timings = eqEditor->getOpenTimings();
+        }
+        run.analyserMs = timings.analyserCreationMs;
+
+        return run; //The editor tells the processor it's going when it is deleted here
+    }
+
+    juce::String toString(const Run& run)
+    {
+        return "construction " + juce::String(run.constructionMs, 2) + " ms, first paint " + juce::String(run.firstPaintMs, 2)
+             + " ms, analyser " + (run.analyserMs < 0.0 ? juce::String("never created") : juce::String(run.analyserMs, 2) + " ms")
+             + " on the first tick";
+    }
+
+    void runEditorBench(const juce::ArgumentList& args)
+    {
+        const auto options = Options::parse(args);
+
+        SimpleEQAudioProcessor processor;
+        processor.setRateAndBufferSizeDetails(options.sampleRate, options.blockSize);
+        processor.prepareToPlay(options.sampleRate, options.blockSize);
+
+        std::vector<Run> runs;
+        for (int i = 0; i < options.numRuns; ++i)
+            runs.push_back(openEditor(processor));
+
+        processor.releaseResources();
+
+        std::cout << "first open: " << toString(runs.front()) << std::endl;
+
+        auto median = [&](auto get)
+        {
+            std::vector<double> values;
+            for (auto& run : runs)
+                values.push_back(get(run));
+            std::sort(values.begin(), values.end());
+            return values[values.size() / 2];
+        };
+        const auto medianOpenMs = median([](const Run& run) { return run.getOpenMs(); });
+
+        std::cout << "median of " << runs.size() << ": construction " << juce::String(median([](const Run& run) { return run.constructionMs; }), 2)
+                  << " ms, first paint " << juce::String(median([](const Run& run) { return run.firstPaintMs; }), 2)
+                  << " ms, analyser " << juce::String(median([](const Run& run) { return run.analyserMs; }), 2)
+                  << " ms, open " << juce::String(medianOpenMs, 2) << " ms (budget " << juce::String(options.maxOpenMs, 0) << " ms)" << std::endl;
+
+        for (auto& run : runs)
+        {
+            if (!run.analyserWasLazy)
+                juce::ConsoleApplication::fail("The analyser was created before the first timer tick, it should be lazy");
+            if (!run.editorWasPainted)
+                juce::ConsoleApplication::fail("The first paint didn't reach the editor");
+        }
+
+        if (medianOpenMs > options.maxOpenMs)
+            juce::ConsoleApplication::fail("Opening the editor takes " + juce::String(medianOpenMs, 2) + " ms, over the "
+                                           + juce::String(options.maxOpenMs, 0) + " ms budget");
+    }
+}
+
+juce::ConsoleApplication::Command EditorBench::getCommand()
+{
+    return { "editorbench",
+             "editorbench [--runs=20] [--max-ms=250]",
+             "Times opening the editor headlessly: construction, first paint and analyser creation",
+             "Opens the editor --runs times on a prepared processor, paints the whole component tree once into an Image\n"
+             "and runs the message loop until the analyser exists. Fails if the analyser isn't created lazily, if the\n"
+             "first paint doesn't reach the editor, or if the median construction plus first paint is over --max-ms.",
+             runEditorBench };
+}
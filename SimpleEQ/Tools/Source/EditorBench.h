@@ -0,0 +1,22 @@
+/*
+  ==============================================================================
+    editorbench: how long the editor takes to open, measured headlessly.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+
+/*
+Opens the editor --runs times on a prepared processor without a window: times the constructor, then paints the
+whole component tree once into an Image (what the first frame of a window does), and then runs the message loop
+until the analyser has been created by the curve's first timer tick. The first run is reported on its own, as it
+also pays for every static the editor sets up once per process.
+
+Fails when the analyser already exists before the first timer tick (it is meant to be created lazily), when the
+first paint didn't reach the editor, or when the median time from construction to the end of the first paint is
+over --max-ms.
+*/
+namespace EditorBench
+{
+    juce::ConsoleApplication::Command getCommand();
+}
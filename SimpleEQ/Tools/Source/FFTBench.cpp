@@ -0,0 +1,216 @@
+/*
+  ==============================================================================
+    fftbench: FFTDataGenerator's fused dB pass against the three loop version.
+  ==============================================================================
+*/
+#include "FFTBench.h"
+#include "../../Source/PluginEditor.h"
+#include <iostream>
+
+namespace
+{
+    constexpr float negativeInfinity = -48.f; //What the editor uses
+
+    //FFTDataGenerator as it was before SpectrumMath, fifo included, so both sides do the same work around the FFT
+    struct ReferenceGenerator
+    {
+        explicit ReferenceGenerator(FFTOrder order)
+            : fftSize(1 << order), forwardFFT(order),
+              window((size_t)fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris)
+        {
+            fftData.resize((size_t)fftSize * 2, 0);
+            fifo.prepare(fftData.size());
+        }
+
+        void produce(const juce::AudioBuffer<float>& audioData)
+        {
+            fftData.assign(fftData.size(), 0);
+            auto* readIndex = audioData.getReadPointer(0);
+            std::copy(readIndex, readIndex + fftSize, fftData.begin());
+
+            window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+            forwardFFT.performFrequencyOnlyForwardTransform(fftData.data());
+
+            const int numBins = fftSize / 2;
+            for (int i = 0; i < numBins; ++i)
+                fftData[(size_t)i] /= (float)numBins;
+            for (int i = 0; i < numBins; ++i)
+                fftData[(size_t)i] = juce::Decibels::gainToDecibels(fftData[(size_t)i], negativeInfinity);
+
+            fifo.push(fftData);
+        }
+
+        bool pull(std::vector<float>& block) { return fifo.pull(block); }
+
+        const int fftSize;
+        juce::dsp::FFT forwardFFT;
+        juce::dsp::WindowingFunction<float> window;
+        std::vector<float> fftData;
+        Fifo<std::vector<float>> fifo;
+    };
+
+    //Noise with a few sines, at levels from loud to below the floor, one window per frame
+    std::vector<juce::AudioBuffer<float>> makeFrames(int fftSize, int numFrames)
+    {
+        juce::Random random(1);
+        std::vector<juce::AudioBuffer<float>> frames;
+        for (int f = 0; f < numFrames; ++f)
+        {
+            juce::AudioBuffer<float> frame(1, fftSize);
+            const auto gain = juce::Decibels::decibelsToGain(-70.f * (float)f / (float)numFrames);
+            for (int i = 0; i < fftSize; ++i)
+            {
+                auto sample = 0.1f * (random.nextFloat() * 2.f - 1.f);
+                for (auto frequency : { 0.013, 0.071, 0.29 })
+                    sample += 0.3f * (float)std::sin(juce::MathConstants<double>::twoPi * frequency * (i + f * 37));
+                frame.setSample(0, i, sample * gain);
+            }
+            frames.push_back(std::move(frame));
+        }
+        return frames;
+    }
+
+    template<typename Function>
+    double microsecondsPerFrame(int numIterations, int numFrames, Function&& run)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numIterations; ++i)
+            run(i % numFrames);
+        return 1.0e6 * juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) / numIterations;
+    }
+
+    //Every 4099th bit pattern of the normal positive floats
+    double getWorstLogError()
+    {
+        double worst = 0.0;
+        for (juce::uint32 bits = 0x00800000; bits < 0x7f800000; bits += 4099)
+        {
+            float power;
+            std::memcpy(&power, &bits, sizeof(power));
+            worst = juce::jmax(worst, std::abs((double)SpectrumMath::powerToDecibels(power) - 10.0 * std::log10((double)power)));
+        }
+        return worst;
+    }
+
+    //Level of a -60 dB sine in its own bin, with the floor well below it. The sine sits on a bin centre, where
+    //the normalised window gives its level back unchanged
+    float getSineBinLevel(FFTOrder order)
+    {
+        constexpr float sineLevel = -60.f, floorLevel = -120.f;
+        constexpr int sineBin = 100;
+
+        FFTDataGenerator<std::vector<float>> generator;
+        generator.changeOrder(order);
+        const auto fftSize = generator.getFFTSize();
+
+        juce::AudioBuffer<float> frame(1, fftSize);
+        const auto amplitude = juce::Decibels::decibelsToGain(sineLevel);
+        for (int i = 0; i < fftSize; ++i)
+            frame.setSample(0, i, amplitude * (float)std::sin(juce::MathConstants<double>::twoPi * sineBin * i / fftSize));
+
+        std::vector<float> block;
+        generator.produceFFTDataForRendering(frame, floorLevel);
+        generator.getFFTData(block);
+        return block[(size_t)sineBin];
+    }
+
+    //The same through SpectrumMath::pairToDecibels, as the Pre/Diff analyser does it: the -60 dB sine as the real
+    //signal and a -30 dB sine two octaves up as the imaginary one. Returns the sine's level and the largest
+    //level the other signal shows in that bin, which should be close to the floor
+    std::pair<float, float> getPairedSineBinLevels()
+    {
+        constexpr float floorLevel = -120.f;
+        constexpr int sineBin = 100;
+
+        auto tables = AnalysisTables::get(FFTOrder::order2048);
+        const auto fftSize = tables->fftSize;
+
+        std::vector<std::complex<float>> timeData((size_t)fftSize), frequencyData((size_t)fftSize);
+        const auto a = juce::Decibels::decibelsToGain(-60.f), b = juce::Decibels::decibelsToGain(-30.f);
+        for (int i = 0; i < fftSize; ++i)
+        {
+            const auto phase = juce::MathConstants<double>::twoPi * sineBin * i / fftSize;
+            timeData[(size_t)i] = { a * (float)std::sin(phase) * tables->scaledWindow[(size_t)i],
+                                    b * (float)std::sin(4.0 * phase) * tables->scaledWindow[(size_t)i] };
+        }
+        tables->fft.perform(timeData.data(), frequencyData.data(), false);
+
+        std::vector<float> decibelsA((size_t)fftSize / 2), decibelsB((size_t)fftSize / 2);
+        SpectrumMath::pairToDecibels(frequencyData.data(), fftSize, decibelsA.data(), decibelsB.data(), floorLevel);
+        return { decibelsA[(size_t)sineBin], decibelsB[(size_t)sineBin] };
+    }
+
+    void runFFTBench(const juce::ArgumentList& args)
+    {
+        auto numIterations = 5000;
+        if (auto v = args.getValueForOption("--frames"); v.isNotEmpty())
+            numIterations = v.getIntValue();
+        if (numIterations < 1)
+            juce::ConsoleApplication::fail("--frames has to be positive");
+
+        const auto logError = getWorstLogError();
+        std::cout << "powerToDecibels worst error: " << juce::String(logError, 6) << " dB (spec "
+                  << juce::String(SpectrumMath::MaxDecibelError, 6) << " dB)" << std::endl;
+
+        float worstDifference = 0.f;
+        for (auto order : { FFTOrder::order2048, FFTOrder::order4096, FFTOrder::order8192 })
+        {
+            ReferenceGenerator reference(order);
+            FFTDataGenerator<std::vector<float>> fused;
+            fused.changeOrder(order);
+
+            const auto fftSize = fused.getFFTSize();
+            const auto frames = makeFrames(fftSize, 64);
+            std::vector<float> referenceBlock, fusedBlock;
+
+            const auto referenceUs = microsecondsPerFrame(numIterations, (int)frames.size(), [&](int f)
+            {
+                reference.produce(frames[(size_t)f]);
+                reference.pull(referenceBlock);
+            });
+            const auto fusedUs = microsecondsPerFrame(numIterations, (int)frames.size(), [&](int f)
+            {
+                fused.produceFFTDataForRendering(frames[(size_t)f], negativeInfinity);
+                fused.getFFTData(fusedBlock);
+            });
+
+            float difference = 0.f;
+            for (auto& frame : frames)
+            {
+                reference.produce(frame);
+                reference.pull(referenceBlock);
+                fused.produceFFTDataForRendering(frame, negativeInfinity);
+                fused.getFFTData(fusedBlock);
+
+                for (int bin = 0; bin < fftSize / 2; ++bin)
+                    difference = juce::jmax(difference, std::abs(referenceBlock[(size_t)bin] - fusedBlock[(size_t)bin]));
+            }
+            worstDifference = juce::jmax(worstDifference, difference);
+
+            std::cout << "fft " << fftSize << ": before " << juce::String(referenceUs, 2) << " us per frame, fused "
+                      << juce::String(fusedUs, 2) << " us (" << juce::String(referenceUs / fusedUs, 2) << "x), largest difference "
+                      << juce::String(difference, 5) << " dB" << std::endl;
+        }
+
+        const auto sineLevel = getSineBinLevel(FFTOrder::order2048);
+        const auto [pairedLevel, otherLevel] = getPairedSineBinLevels();
+        std::cout << "-60 dB sine bin: " << juce::String(sineLevel, 3) << " dB, paired " << juce::String(pairedLevel, 3)
+                  << " dB (other signal " << juce::String(otherLevel, 1) << " dB)" << std::endl;
+
+        if (logError > SpectrumMath::MaxDecibelError || worstDifference > 0.01f)
+            juce::ConsoleApplication::fail("The fused pass doesn't give the levels it should");
+        if (std::abs(sineLevel + 60.f) > 0.1f || std::abs(pairedLevel + 60.f) > 0.1f || otherLevel > -90.f)
+            juce::ConsoleApplication::fail("A -60 dB sine doesn't read -60 dB");
+    }
+}
+
+juce::ConsoleApplication::Command FFTBench::getCommand()
+{
+    return { "fftbench",
+             "fftbench [--frames=5000]",
+             "Times the analyser's FFT frame against the unfused version, for every FFT order",
+             "Each side does --frames frames of noise and sines through window, FFT and dB conversion and a fifo push\n"
+             "and pull. Fails if the levels differ by more than 0.01 dB, if the log approximation is outside its spec, or if\n"
+             "a -60 dB sine doesn't read -60 dB in its bin, through the single and the paired transform.",
+             runFFTBench };
+}
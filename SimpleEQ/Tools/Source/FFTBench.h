@@ -0,0 +1,19 @@
+/*
+  ==============================================================================
+    fftbench: FFTDataGenerator's fused dB pass against the three loop version.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+
+/*
+For every FFT order the analyser offers, times FFTDataGenerator::produceFFTDataForRendering against
+the way it used to work (clear, copy, window, magnitude FFT, divide, gainToDecibels), checks the two
+give the same levels, checks that a -60 dB sine reads -60 dB above a -120 dB floor (also through the
+Pre/Diff analyser's paired transform), and checks SpectrumMath::powerToDecibels against log10 over the
+whole float range.
+*/
+namespace FFTBench
+{
+    juce::ConsoleApplication::Command getCommand();
+}
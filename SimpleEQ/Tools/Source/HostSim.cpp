@@ -0,0 +1,301 @@
+/*
+  ==============================================================================
+    hostsim: runs the processor the way a host would, without a host.
+  ==============================================================================
+*/
+#include "HostSim.h"
+#include "../../Source/PluginProcessor.h"
+#include <cmath>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+    struct Options
+    {
+        juce::Array<double> sampleRates{ 44100.0, 48000.0, 96000.0, 22050.0, 192000.0 };
+        double secondsPerRate = 10.0;  //Of audio, not of wall clock time
+        juce::int64 seed = 0;
+        int announcedBlockSize = 0;    //0: a random one from announcedSizes at every prepareToPlay
+        int maxBlockSize = 8192;
+        int parametersPerBlock = 8;    //Automation density
+        double deadlineFraction = 1.0; //Of the buffer period the plugin may use
+        bool realtime = false;         //Pace the blocks like a sound card would, instead of running flat out
+        bool failOnMiss = false;
+
+        static Options parse(const juce::ArgumentList& args)
+        {
+            Options options;
+            options.seed = juce::Time::currentTimeMillis();
+
+            auto get = [&](juce::StringRef option) { return args.getValueForOption(option); };
+
+            if (auto rates = get("--rates"); rates.isNotEmpty())
+            {
+                options.sampleRates.clear();
+                for (auto& rate : juce::StringArray::fromTokens(rates, ",", ""))
+                    options.sampleRates.add(rate.getDoubleValue());
+            }
+            if (auto v = get("--seconds"); v.isNotEmpty())  options.secondsPerRate = v.getDoubleValue();
+            if (auto v = get("--seed"); v.isNotEmpty())     options.seed = v.getLargeIntValue();
+            if (auto v = get("--block"); v.isNotEmpty())    options.announcedBlockSize = v.getIntValue();
+            if (auto v = get("--max-block"); v.isNotEmpty()) options.maxBlockSize = v.getIntValue();
+            if (auto v = get("--automation"); v.isNotEmpty()) options.parametersPerBlock = v.getIntValue();
+            if (auto v = get("--deadline"); v.isNotEmpty()) options.deadlineFraction = v.getDoubleValue();
+            options.realtime = args.containsOption("--realtime");
+            options.failOnMiss = args.containsOption("--fail-on-miss");
+
+            for (auto rate : options.sampleRates)
+                if (rate < 8000.0 || rate > 768000.0)
+                    juce::ConsoleApplication::fail("Unsupported sample rate: " + juce::String(rate));
+
+            if (options.maxBlockSize < 1 || options.secondsPerRate <= 0.0 || options.deadlineFraction <= 0.0)
+                juce::ConsoleApplication::fail("--max-block, --seconds and --deadline have to be positive");
+
+            return options;
+        }
+    };
+
+    //What hosts commonly announce in prepareToPlay
+    constexpr int announcedSizes[] = { 32, 64, 128, 256, 441, 480, 512, 1024, 2048 };
+
+    struct RateResult
+    {
+        double sampleRate = 0.0;
+        int announcedBlockSize = 0;
+        juce::int64 numBlocks = 0, numOversized = 0, numMisses = 0, numNonFinite = 0;
+        int firstBlockViolations = 0; //RealtimeCheck violations in the first block after prepareToPlay
+        int smallestBlock = 0, largestBlock = 0;
+        juce::String hostTiming, pluginTiming;
+
+        juce::String toString() const
+        {
+            return juce::String(sampleRate, 0) + " Hz, announced " + juce::String(announcedBlockSize)
+                 + ": " + juce::String(numBlocks) + " blocks of " + juce::String(smallestBlock) + "-" + juce::String(largestBlock)
+                 + " samples (" + juce::String(numOversized) + " bigger than announced), "
+                 + juce::String(numMisses) + " deadline misses, " + juce::String(numNonFinite) + " non finite outputs, "
+                 + juce::String(firstBlockViolations) + " violations in the first block"
+                 + "\n    host:   " + hostTiming
+                 + "\n    plugin: " + pluginTiming;
+        }
+    };
+
+    class SimulatedAudioThread : public juce::Thread
+    {
+    public:
+        SimulatedAudioThread(SimpleEQAudioProcessor& p, const Options& o)
+            : juce::Thread("hostsim audio"), processor(p), options(o), random(o.seed)
+        {
+            for (auto* parameter : processor.getParameters())
+                if (parameter != processor.getBypassParameter())
+                    automated.add(parameter);
+        }
+
+        void run() override
+        {
+            for (auto rate : options.sampleRates)
+            {
+                if (threadShouldExit())
+                    break;
+                results.add(runAtSampleRate(rate));
+            }
+        }
+
+        juce::Array<RateResult> results; //Read once the thread has finished
+
+    private:
+        SimpleEQAudioProcessor& processor;
+        const Options options;
+        juce::Random random;
+        juce::Array<juce::AudioProcessorParameter*> automated;
+        BlockTimingHistogram hostTiming; //What the host sees: the whole processBlock call
+
+        //prepareToPlay belongs on the message thread, with the audio stopped, like in a host
+        void prepare(double sampleRate, int blockSize)
+        {
+            juce::WaitableEvent done;
+            juce::MessageManager::callAsync([&]
+            {
+                processor.releaseResources();
+                processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+                processor.prepareToPlay(sampleRate, blockSize);
+                done.signal();
+            });
+            done.wait();
+        }
+
+        //Mostly the announced size, often less (loop points, sample accurate automation), now and then
+        //a single sample, and sometimes more than announced, which hosts are not supposed to do but do
+        int nextBlockSize(int announced)
+        {
+            auto x = random.nextFloat();
+            if (x < 0.55f) return announced;
+            if (x < 0.85f) return 1 + random.nextInt(announced);
+            if (x < 0.90f) return 1;
+            return juce::jmin(options.maxBlockSize, announced + 1 + random.nextInt(juce::jmax(1, options.maxBlockSize - announced)));
+        }
+
+        //Noise and a sweeping sine, with a silent gap every other second so the silence skipping gets exercised too
+        void fillInput(juce::AudioBuffer<float>& buffer, juce::int64 position, double sampleRate)
+        {
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                auto t = (double)(position + i) / sampleRate;
+                auto silent = std::fmod(t, 2.0) > 1.5;
+                auto sine = (float)std::sin(juce::MathConstants<double>::twoPi * (200.0 + 2000.0 * std::fmod(t, 1.0)) * t);
+
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    buffer.setSample(channel, i, silent ? 0.f : 0.25f * sine + 0.1f * (random.nextFloat() * 2.f - 1.f));
+            }
+        }
+
+        void automate(juce::int64 position, double sampleRate)
+        {
+            for (int i = 0; i < options.parametersPerBlock && automated.size() > 0; ++i)
+                automated[random.nextInt(automated.size())]->setValueNotifyingHost(random.nextFloat());
+
+            //Bypassed for a quarter of every third second
+            if (auto* bypass = processor.getBypassParameter())
+                bypass->setValueNotifyingHost(std::fmod((double)position / sampleRate, 3.0) > 2.75 ? 1.f : 0.f);
+        }
+
+        RateResult runAtSampleRate(double sampleRate)
+        {
+            RateResult result;
+            result.sampleRate = sampleRate;
+            result.announcedBlockSize = options.announcedBlockSize > 0 ? options.announcedBlockSize
+                                      : announcedSizes[random.nextInt((int)std::size(announcedSizes))];
+            result.smallestBlock = std::numeric_limits<int>::max();
+
+            prepare(sampleRate, result.announcedBlockSize);
+            processor.getBlockTiming().reset();
+            hostTiming.reset();
+
+            const auto numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+            juce::AudioBuffer<float> storage(numChannels, juce::jmax(options.maxBlockSize, result.announcedBlockSize));
+            juce::MidiBuffer midi;
+
+            const auto totalSamples = (juce::int64)(options.secondsPerRate * sampleRate);
+            auto nextCallback = juce::Time::getHighResolutionTicks();
+
+            for (juce::int64 position = 0; position < totalSamples && !threadShouldExit();)
+            {
+                const auto numSamples = nextBlockSize(result.announcedBlockSize);
+                const auto period = numSamples / sampleRate;
+                juce::AudioBuffer<float> block(storage.getArrayOfWritePointers(), numChannels, 0, numSamples); //Exactly numSamples long, like a host's
+
+                fillInput(block, position, sampleRate);
+                automate(position, sampleRate);
+
+                if (options.realtime) //The sound card asks for the next block one period after the last one
+                {
+                    nextCallback += juce::Time::secondsToHighResolutionTicks(period);
+                    auto wait = juce::Time::highResolutionTicksToSeconds(nextCallback - juce::Time::getHighResolutionTicks());
+                    if (wait >= 0.001)
+                        juce::Thread::sleep((int)(wait * 1000.0));
+                }
+
+                const auto violationsBefore = RealtimeCheck::getNumViolations();
+                const auto start = juce::Time::getHighResolutionTicks();
+                processor.processBlock(block, midi);
+                const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+                //Anything left for the first block to set up (filter state, buffers) allocates on the audio thread
+                if (result.numBlocks == 0)
+                    result.firstBlockViolations = RealtimeCheck::getNumViolations() - violationsBefore;
+
+                hostTiming.record(seconds, period);
+                if (seconds > period * options.deadlineFraction)
+                    ++result.numMisses;
+
+                for (int channel = 0; channel < processor.getTotalNumOutputChannels(); ++channel)
+                {
+                    auto range = juce::FloatVectorOperations::findMinAndMax(block.getReadPointer(channel), numSamples);
+                    if (!std::isfinite(range.getStart()) || !std::isfinite(range.getEnd()))
+                    {
+                        ++result.numNonFinite;
+                        break;
+                    }
+                }
+
+                ++result.numBlocks;
+                result.numOversized += numSamples > result.announcedBlockSize ? 1 : 0;
+                result.smallestBlock = juce::jmin(result.smallestBlock, numSamples);
+                result.largestBlock = juce::jmax(result.largestBlock, numSamples);
+                position += numSamples;
+            }
+
+            result.hostTiming = hostTiming.toString();
+            result.pluginTiming = processor.getBlockTiming().toString();
+            return result;
+        }
+    };
+
+    void runHostSim(const juce::ArgumentList& args)
+    {
+        const auto options = Options::parse(args);
+        std::cout << "hostsim --seed=" << options.seed << std::endl; //Same seed, same blocks and automation
+
+       #if ! SIMPLEEQ_RT_CHECKS
+        std::cout << "Built without SIMPLEEQ_RT_CHECKS, allocations and locks in processBlock won't be seen" << std::endl;
+       #endif
+
+        SimpleEQAudioProcessor processor;
+        processor.addAnalyserConsumer(); //So the analyser capture runs as it does with the editor open
+        RealtimeCheck::clear();
+
+        SimulatedAudioThread audioThread(processor, options);
+        audioThread.startThread(juce::Thread::realtimeAudioPriority);
+
+        juce::AudioBuffer<float> drained;
+        while (audioThread.isThreadRunning())
+        {
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(10);
+
+            //Stand in for the editor's path producers
+            while (processor.leftChannelFifo.getNumCompleteBufferAvailable() > 0)
+                processor.leftChannelFifo.getAudioBuffer(drained);
+            while (processor.rightChannelFifo.getNumCompleteBufferAvailable() > 0)
+                processor.rightChannelFifo.getAudioBuffer(drained);
+        }
+
+        processor.removeAnalyserConsumer();
+
+        juce::int64 misses = 0, nonFinite = 0;
+        int firstBlockViolations = 0;
+        for (auto& result : audioThread.results)
+        {
+            std::cout << result.toString() << std::endl;
+            misses += result.numMisses;
+            nonFinite += result.numNonFinite;
+            firstBlockViolations += result.firstBlockViolations;
+        }
+
+        if (firstBlockViolations > 0)
+            juce::ConsoleApplication::fail(RealtimeCheck::getReport() + "\nThe first block after prepareToPlay is not real time safe: "
+                                           + juce::String(firstBlockViolations) + " violations, prepareToPlay left something unprepared");
+
+        if (RealtimeCheck::getNumViolations() > 0)
+            juce::ConsoleApplication::fail(RealtimeCheck::getReport() + "\nprocessBlock is not real time safe: "
+                                           + juce::String(RealtimeCheck::getNumViolations()) + " violations");
+        if (nonFinite > 0)
+            juce::ConsoleApplication::fail(juce::String(nonFinite) + " blocks came out with NaN or inf");
+        if (options.failOnMiss && misses > 0)
+            juce::ConsoleApplication::fail(juce::String(misses) + " blocks missed their deadline");
+    }
+}
+
+juce::ConsoleApplication::Command HostSim::getCommand()
+{
+    return { "hostsim",
+             "hostsim [--rates=44100,48000] [--seconds=10] [--seed=n] [--block=n] [--max-block=8192]\n"
+             "        [--automation=8] [--deadline=1.0] [--realtime] [--fail-on-miss]",
+             "Runs the processor with random block sizes, sample rate changes and dense automation",
+             "Each sample rate is prepared with the announced block size (--block, or a random common one) and run for\n"
+             "--seconds of audio in blocks of random sizes, some bigger than announced. --automation parameters move\n"
+             "before every block. A block misses its deadline when it takes more than --deadline times its buffer period.\n"
+             "--realtime paces the blocks like a sound card instead of running as fast as possible.\n"
+             "Fails on any allocation or lock inside processBlock (the first block after each prepareToPlay is checked on its own), "
+             "on NaN or inf output, and with --fail-on-miss on a missed deadline.",
+             runHostSim };
+}
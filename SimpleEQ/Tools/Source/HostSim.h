@@ -0,0 +1,25 @@
+/*
+  ==============================================================================
+    hostsim: runs the processor the way a host would, without a host.
+  ==============================================================================
+*/
+#pragma once
+#include <JuceHeader.h>
+
+/*
+Drives a SimpleEQAudioProcessor from a separate "audio" thread while the main thread runs the message loop,
+so the processor's timer, the band redesigns and prepareToPlay happen on the message thread as in a host.
+
+Every sample rate in the list gets its own prepareToPlay with a randomly announced block size, and then
+blocks of random sizes: mostly the announced one, often less, sometimes a single sample and sometimes
+more than announced. Before each block a few random parameters are moved, and the bypass flips now and then.
+
+Each block is timed against its buffer period (numSamples / sampleRate). The run fails when processBlock
+allocated or locked (RealtimeCheck), with its own message when that was the first block after a prepareToPlay
+(state that prepareToPlay should have sized), when the output is not finite, or with --fail-on-miss, when a block
+missed its deadline.
+*/
+namespace HostSim
+{
+    juce::ConsoleApplication::Command getCommand();
+}
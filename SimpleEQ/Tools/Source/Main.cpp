@@ -0,0 +1,31 @@
+/*
+  ==============================================================================
+    SimpleEQTools: command line tools that run the plugin's code without a host.
+  ==============================================================================
+*/
+#include <JuceHeader.h>
+#include "HostSim.h"
+#include "BatchBench.h"
+#include "Daemon.h"
+#include "DaemonBench.h"
+#include "Analyse.h"
+#include "FFTBench.h"
+#include "EditorBench.h"
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; //The processor owns a Timer and the APVTS, both need a MessageManager
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand("--help|-h", "Usage:", true);
+    app.addCommand(HostSim::getCommand());
+    app.addCommand(BatchBench::getCommand());
+    app.addCommand(Daemon::getCommand());
+    app.addCommand(DaemonBench::getBenchCommand());
+    app.addCommand(DaemonBench::getClientCommand());
+    app.addCommand(Analyse::getCommand());
+    app.addCommand(FFTBench::getCommand());
+    app.addCommand(EditorBench::getCommand());
+
+    return app.findAndRunCommand(argc, argv);
+}